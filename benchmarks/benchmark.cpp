@@ -0,0 +1,151 @@
+#include <cmath>
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include <core/entity.hpp>
+
+#include "benchmark.hpp"
+
+namespace
+{
+    struct RegisteredBenchmark
+    {
+        std::string mName;
+        BenchmarkFunction mFunction;
+        std::vector<std::size_t> mCounts;
+    };
+
+    std::vector<RegisteredBenchmark>& GetRegisteredBenchmarks()
+    {
+        static std::vector<RegisteredBenchmark> benchmarks;
+        return benchmarks;
+    }
+
+    const char* FindArgument(int argc, char** argv, const char* name)
+    {
+        const auto length = std::strlen(name);
+        for (auto i = 1; i < argc; i++)
+        {
+            if (std::strncmp(argv[i], name, length) == 0 && argv[i][length] == '=')
+            {
+                return argv[i] + length + 1;
+            }
+        }
+        return nullptr;
+    }
+
+    void WriteResult(std::ostream& out, const std::string& name, const BenchmarkState& state)
+    {
+        auto samples = state.GetSamples();
+        std::sort(samples.begin(), samples.end());
+        const auto size = samples.size();
+        const auto median = size % 2 == 1 ? samples[size / 2] : (samples[size / 2 - 1] + samples[size / 2]) / 2.0;
+        auto mean = 0.0;
+        for (auto sample : samples)
+        {
+            mean += sample / size;
+        }
+        auto variance = 0.0;
+        for (auto sample : samples)
+        {
+            variance += (sample - mean) * (sample - mean) / (size > 1 ? size - 1 : 1);
+        }
+        out << "    {\"name\": \"" << name << "\", \"count\": " << state.GetCount()
+            << ", \"repetitions\": " << size
+            << ", \"min_ns\": " << samples.front()
+            << ", \"median_ns\": " << median
+            << ", \"mean_ns\": " << mean
+            << ", \"stddev_ns\": " << std::sqrt(variance)
+            << ", \"max_ns\": " << samples.back()
+            << ", \"items_per_second\": " << state.GetCount() / (median * 1e-9);
+        if (state.GetBytesProcessed() > 0)
+        {
+            out << ", \"bytes_per_second\": " << state.GetBytesProcessed() / (median * 1e-9);
+        }
+        out << "}";
+    }
+}
+
+BenchmarkState::BenchmarkState(std::size_t count, std::size_t repetitions) : mCount(count), mRepetitions(repetitions)
+{
+
+}
+
+std::size_t BenchmarkState::GetCount() const
+{
+    return mCount;
+}
+
+std::size_t BenchmarkState::GetRepetitions() const
+{
+    return mRepetitions;
+}
+
+const std::vector<double>& BenchmarkState::GetSamples() const
+{
+    return mSamples;
+}
+
+std::size_t BenchmarkState::GetBytesProcessed() const
+{
+    return mBytesProcessed;
+}
+
+void BenchmarkState::SetBytesProcessed(std::size_t bytes)
+{
+    mBytesProcessed = bytes;
+}
+
+bool RegisterBenchmark(const char* name, BenchmarkFunction function, std::initializer_list<std::size_t> counts)
+{
+    GetRegisteredBenchmarks().push_back({ name, function, counts });
+    return true;
+}
+
+// usage: alive_benchmarks [--filter=substring] [--repetitions=N] [--out=results.json]
+int RunBenchmarks(int argc, char** argv)
+{
+    const auto filter = FindArgument(argc, argv, "--filter");
+    const auto repetitions = FindArgument(argc, argv, "--repetitions");
+    const auto outPath = FindArgument(argc, argv, "--out");
+
+    std::ofstream outFile;
+    if (outPath != nullptr)
+    {
+        outFile.open(outPath);
+        if (!outFile)
+        {
+            std::cerr << "alive_benchmarks: cannot open " << outPath << std::endl;
+            return 1;
+        }
+    }
+    auto& out = outPath != nullptr ? static_cast<std::ostream&>(outFile) : std::cout;
+    out.precision(17);
+    out << "{\n  \"context\": {\"entity_pointer_bits\": " << sizeof(Entity::PointerSize) * 8 << "},\n  \"benchmarks\": [\n";
+    auto first = true;
+    for (const auto& benchmark : GetRegisteredBenchmarks())
+    {
+        if (filter != nullptr && benchmark.mName.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+        for (auto count : benchmark.mCounts)
+        {
+            BenchmarkState state(count, repetitions != nullptr ? std::stoul(repetitions) : 10);
+            benchmark.mFunction(state);
+            if (state.GetSamples().empty())
+            {
+                continue;
+            }
+            out << (first ? "" : ",\n");
+            WriteResult(out, benchmark.mName, state);
+            first = false;
+            std::cerr << benchmark.mName << "/" << count << " done" << std::endl;
+        }
+    }
+    out << "\n  ]\n}" << std::endl;
+    return 0;
+}
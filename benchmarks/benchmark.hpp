@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <initializer_list>
+
+class BenchmarkState final
+{
+public:
+    BenchmarkState(std::size_t count, std::size_t repetitions);
+
+public:
+    std::size_t GetCount() const;
+    std::size_t GetRepetitions() const;
+    const std::vector<double>& GetSamples() const;
+    std::size_t GetBytesProcessed() const;
+    void SetBytesProcessed(std::size_t bytes);
+
+public:
+    // runs setup untimed then times body, once for warm-up and once per repetition
+    template<typename S, typename B>
+    void Measure(S&& setup, B&& body);
+
+private:
+    std::size_t mCount = 0;
+    std::size_t mRepetitions = 0;
+    std::size_t mBytesProcessed = 0;
+    std::vector<double> mSamples; // nanoseconds per repetition
+};
+
+using BenchmarkFunction = void (*)(BenchmarkState& state);
+
+bool RegisterBenchmark(const char* name, BenchmarkFunction function, std::initializer_list<std::size_t> counts);
+int RunBenchmarks(int argc, char** argv);
+
+// keeps the optimizer from discarding a computed value
+template<typename T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+// declares a benchmark run once per entity count given
+#define ALIVE_BENCHMARK(NAME, ...) \
+    static void NAME(BenchmarkState& state); \
+    static const bool NAME##Registered = RegisterBenchmark(#NAME, &NAME, { __VA_ARGS__ }); \
+    static void NAME(BenchmarkState& state)
+
+template<typename S, typename B>
+void BenchmarkState::Measure(S&& setup, B&& body)
+{
+    mSamples.clear();
+    for (std::size_t repetition = 0; repetition <= mRepetitions; repetition++)
+    {
+        setup();
+        const auto t0 = std::chrono::steady_clock::now();
+        body();
+        const auto t1 = std::chrono::steady_clock::now();
+        if (repetition > 0)
+        {
+            mSamples.emplace_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+        }
+    }
+}
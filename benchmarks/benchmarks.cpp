@@ -0,0 +1,377 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <future>
+#include <fstream>
+#include <sstream>
+
+#include <core/entitymanager.hpp>
+
+#include "benchmark.hpp"
+#include "../tests/test_systems/systems.hpp"
+#include "../tests/test_components/components.hpp"
+
+namespace
+{
+    // one entity in every `sparsity` gets a TransformComponent, the others a DummyComponent
+    std::unique_ptr<EntityManager> CreatePopulatedEntityManager(std::size_t count, std::size_t sparsity)
+    {
+        auto manager = CreateEntityManager();
+        for (std::size_t i = 0; i < count; i++)
+        {
+            if (i % sparsity == 0)
+            {
+                manager->CreateEntityWith<TransformComponent, PhysicsComponent>();
+            }
+            else
+            {
+                manager->CreateEntityWith<DummyComponent>();
+            }
+        }
+        return manager;
+    }
+
+    // C++14 has no std::filesystem::temp_directory_path, the usual variables are looked up instead
+    std::string GetTemporaryPath(const std::string& name)
+    {
+        for (auto variable : { "TMPDIR", "TMP", "TEMP" })
+        {
+            if (const auto directory = std::getenv(variable))
+            {
+                return std::string{ directory } + "/" + name;
+            }
+        }
+        return "/tmp/" + name;
+    }
+
+    // removes the file when the benchmark ends, early or not
+    class TemporaryFile final
+    {
+    public:
+        explicit TemporaryFile(const std::string& name) : mPath(GetTemporaryPath(name))
+        {
+        }
+        ~TemporaryFile()
+        {
+            std::remove(mPath.c_str());
+        }
+
+    public:
+        TemporaryFile(const TemporaryFile&) = delete;
+        TemporaryFile& operator=(const TemporaryFile&) = delete;
+
+    public:
+        const std::string& GetPath() const
+        {
+            return mPath;
+        }
+
+    private:
+        std::string mPath;
+    };
+
+    void BenchmarkIteration(BenchmarkState& state, std::size_t sparsity)
+    {
+        auto manager = CreatePopulatedEntityManager(state.GetCount(), sparsity);
+        state.Measure([] {}, [&]
+        {
+            auto sum = 0.0f;
+            manager->With<TransformComponent>([&](Entity, TransformComponent* transform)
+                                              {
+                                                  sum += transform->GetX();
+                                              });
+            DoNotOptimize(sum);
+        });
+    }
+}
+
+ALIVE_BENCHMARK(CreateEntities, 1000, 10000, 100000)
+{
+    std::unique_ptr<EntityManager> manager;
+    state.Measure([&] { manager = CreateEntityManager(); }, [&]
+    {
+        for (std::size_t i = 0; i < state.GetCount(); i++)
+        {
+            DoNotOptimize(manager->CreateEntity());
+        }
+    });
+}
+
+ALIVE_BENCHMARK(CreateEntitiesWithComponents, 1000, 10000, 100000)
+{
+    std::unique_ptr<EntityManager> manager;
+    state.Measure([&] { manager = CreateEntityManager(); }, [&]
+    {
+        for (std::size_t i = 0; i < state.GetCount(); i++)
+        {
+            DoNotOptimize(manager->CreateEntityWith<DummyComponent, TransformComponent, PhysicsComponent>());
+        }
+    });
+}
+
+ALIVE_BENCHMARK(CreateEntitiesWithBatch, 1000, 10000, 100000)
+{
+    std::unique_ptr<EntityManager> manager;
+    std::vector<Entity> entities;
+    state.Measure([&]
+                  {
+                      manager = CreateEntityManager();
+                      entities.clear();
+                  }, [&]
+                  {
+                      manager->CreateEntitiesWith<DummyComponent, TransformComponent, PhysicsComponent>(state.GetCount(), entities);
+                  });
+}
+
+ALIVE_BENCHMARK(DestroyEntities, 1000, 10000, 100000)
+{
+    std::unique_ptr<EntityManager> manager;
+    std::vector<Entity> entities;
+    state.Measure([&]
+                  {
+                      manager = CreateEntityManager();
+                      entities.clear();
+                      for (std::size_t i = 0; i < state.GetCount(); i++)
+                      {
+                          entities.emplace_back(manager->CreateEntityWith<TransformComponent, PhysicsComponent>());
+                      }
+                  }, [&]
+                  {
+                      for (auto& entity : entities)
+                      {
+                          entity.Destroy();
+                      }
+                  });
+}
+
+ALIVE_BENCHMARK(DestroyEntitiesBatch, 1000, 10000, 100000)
+{
+    std::unique_ptr<EntityManager> manager;
+    std::vector<Entity> entities;
+    state.Measure([&]
+                  {
+                      manager = CreateEntityManager();
+                      entities.clear();
+                      manager->CreateEntitiesWith<TransformComponent, PhysicsComponent>(state.GetCount(), entities);
+                  }, [&]
+                  {
+                      manager->DestroyEntities(entities);
+                  });
+}
+
+ALIVE_BENCHMARK(AddRemoveComponent, 1000, 10000, 100000)
+{
+    auto manager = CreateEntityManager();
+    std::vector<Entity> entities;
+    for (std::size_t i = 0; i < state.GetCount(); i++)
+    {
+        entities.emplace_back(manager->CreateEntityWith<DummyComponent>());
+    }
+    state.Measure([] {}, [&]
+    {
+        for (auto& entity : entities)
+        {
+            entity.AddComponent<TransformComponent>();
+        }
+        for (auto& entity : entities)
+        {
+            entity.RemoveComponent<TransformComponent>();
+        }
+    });
+}
+
+ALIVE_BENCHMARK(IterateDense, 1000, 10000, 100000)
+{
+    BenchmarkIteration(state, 1);
+}
+
+ALIVE_BENCHMARK(IterateSparse10, 1000, 10000, 100000)
+{
+    BenchmarkIteration(state, 10);
+}
+
+ALIVE_BENCHMARK(IterateSparse1000, 1000, 10000, 100000)
+{
+    BenchmarkIteration(state, 1000);
+}
+
+ALIVE_BENCHMARK(IterateTwoComponents, 1000, 10000, 100000)
+{
+    auto manager = CreatePopulatedEntityManager(state.GetCount(), 2);
+    state.Measure([] {}, [&]
+    {
+        auto sum = 0.0f;
+        for (auto tuple : manager->View<TransformComponent, PhysicsComponent>())
+        {
+            sum += std::get<1>(tuple).GetY();
+        }
+        DoNotOptimize(sum);
+    });
+}
+
+ALIVE_BENCHMARK(IterateQuerySparse1000, 1000, 10000, 100000)
+{
+    auto manager = CreatePopulatedEntityManager(state.GetCount(), 1000);
+    auto query = manager->Query<TransformComponent>();
+    state.Measure([] {}, [&]
+    {
+        auto sum = 0.0f;
+        query.Each([&](Entity, TransformComponent& transform)
+                   {
+                       sum += transform.GetX();
+                   });
+        DoNotOptimize(sum);
+    });
+}
+
+ALIVE_BENCHMARK(Serialize, 1000, 10000, 100000)
+{
+    auto manager = CreatePopulatedEntityManager(state.GetCount(), 2);
+    std::stringstream stream;
+    state.Measure([&] { stream.str(std::string{}); }, [&]
+    {
+        manager->Serialize(stream);
+    });
+    state.SetBytesProcessed(stream.str().size());
+}
+
+ALIVE_BENCHMARK(SerializeAsync, 1000, 10000, 100000)
+{
+    // only the time the calling thread is held, the write of the previous run is waited for outside the measure
+    auto manager = CreatePopulatedEntityManager(state.GetCount(), 2);
+    std::stringstream stream;
+    std::future<void> saved;
+    state.Measure([&]
+                  {
+                      if (saved.valid())
+                      {
+                          saved.get();
+                      }
+                      stream.str(std::string{});
+                  }, [&]
+                  {
+                      saved = manager->SerializeAsync(stream);
+                  });
+    saved.get();
+}
+
+ALIVE_BENCHMARK(Deserialize, 1000, 10000, 100000)
+{
+    auto manager = CreatePopulatedEntityManager(state.GetCount(), 2);
+    std::stringstream serialized;
+    manager->Serialize(serialized);
+    const auto bytes = serialized.str();
+    std::stringstream stream;
+    state.Measure([&] { stream.clear(); stream.str(bytes); }, [&]
+    {
+        manager->Deserialize(stream);
+    });
+    state.SetBytesProcessed(bytes.size());
+}
+
+ALIVE_BENCHMARK(DeserializeParallel, 1000, 10000, 100000)
+{
+    auto manager = CreatePopulatedEntityManager(state.GetCount(), 2);
+    manager->SetParallelSnapshotLoad(true);
+    std::stringstream serialized;
+    manager->Serialize(serialized);
+    const auto bytes = serialized.str();
+    std::stringstream stream;
+    state.Measure([&] { stream.clear(); stream.str(bytes); }, [&]
+    {
+        manager->Deserialize(stream);
+    });
+    state.SetBytesProcessed(bytes.size());
+}
+
+ALIVE_BENCHMARK(SerializeCompressed, 1000, 10000, 100000)
+{
+    auto manager = CreatePopulatedEntityManager(state.GetCount(), 2);
+    std::stringstream stream;
+    state.Measure([&] { stream.str(std::string{}); }, [&]
+    {
+        manager->Serialize(stream, SnapshotCompression::eBlock);
+    });
+    state.SetBytesProcessed(stream.str().size());
+}
+
+ALIVE_BENCHMARK(DeserializeCompressed, 1000, 10000, 100000)
+{
+    auto manager = CreatePopulatedEntityManager(state.GetCount(), 2);
+    std::stringstream serialized;
+    manager->Serialize(serialized, SnapshotCompression::eBlock);
+    const auto bytes = serialized.str();
+    std::stringstream stream;
+    state.Measure([&] { stream.clear(); stream.str(bytes); }, [&]
+    {
+        manager->Deserialize(stream);
+    });
+    state.SetBytesProcessed(bytes.size());
+}
+
+ALIVE_BENCHMARK(LoadSnapshot, 1000, 10000, 100000)
+{
+    const TemporaryFile snapshot("alive_benchmark_snapshot.bin");
+    auto manager = CreatePopulatedEntityManager(state.GetCount(), 2);
+    {
+        std::ofstream os(snapshot.GetPath(), std::ios::out | std::ios::binary);
+        manager->Serialize(os);
+    }
+    state.Measure([] {}, [&]
+    {
+        manager->LoadSnapshot(snapshot.GetPath());
+    });
+}
+
+ALIVE_BENCHMARK(SerializeDelta, 1000, 10000, 100000)
+{
+    // one entity in a hundred changed since the baseline, the rest of the world is left out of the delta
+    auto manager = CreatePopulatedEntityManager(state.GetCount(), 2);
+    auto entities = manager->With<TransformComponent>();
+    std::stringstream stream;
+    state.Measure([&]
+                  {
+                      stream.str(std::string{});
+                      manager->ClearChanges();
+                      for (std::size_t i = 0; i < entities.size(); i += 100)
+                      {
+                          entities[i].GetComponent<TransformComponent>()->mData.x += 1.0f;
+                      }
+                  }, [&]
+                  {
+                      manager->SerializeDelta(stream);
+                  });
+    state.SetBytesProcessed(stream.str().size());
+}
+
+ALIVE_BENCHMARK(GetSystem, 1000, 100000)
+{
+    auto manager = CreateEntityManager();
+    manager->AddSystem<WorldStateSystem>(nullptr, nullptr);
+    manager->AddSystem<GridMapSystem>();
+    manager->ResolveSystemDependencies();
+    state.Measure([] {}, [&]
+    {
+        for (std::size_t i = 0; i < state.GetCount(); i++)
+        {
+            DoNotOptimize(manager->GetSystem<GridMapSystem>());
+            DoNotOptimize(manager->GetSystem<WorldStateSystem>());
+        }
+    });
+}
+
+ALIVE_BENCHMARK(GetMemoryStats, 1000, 100000)
+{
+    auto manager = CreatePopulatedEntityManager(state.GetCount(), 2);
+    MemoryStats stats;
+    state.Measure([] {}, [&]
+    {
+        manager->GetMemoryStats(stats);
+        DoNotOptimize(stats.GetByteSize());
+    });
+}
+
+int main(int argc, char** argv)
+{
+    return RunBenchmarks(argc, argv);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+#include "entity.hpp"
+#include "componentinfo.hpp"
+
+class ArchetypeChunk final
+{
+public:
+    static constexpr std::size_t ByteSize = 16 * 1024;
+
+public:
+    explicit ArchetypeChunk(std::size_t byteSize);
+
+public:
+    std::size_t mCount = 0;
+    std::unique_ptr<unsigned char[]> mData;
+};
+
+class Archetype final
+{
+public:
+    Archetype(const ComponentMask& componentMask, std::vector<ComponentInfo> componentInfos);
+    ~Archetype();
+
+public:
+    Archetype(const Archetype&) = delete;
+    Archetype& operator=(const Archetype&) = delete;
+
+public:
+    const ComponentMask& GetComponentMask() const;
+    std::size_t GetColumnCount() const;
+    const ComponentInfo& GetComponentInfo(std::size_t column) const;
+    std::ptrdiff_t FindColumn(ComponentTypeId typeId) const;
+
+public:
+    std::size_t Size() const;
+    std::size_t GetChunkCount() const;
+    std::size_t GetChunkSize(std::size_t chunk) const;
+    std::size_t GetChunkCapacity() const;
+    std::size_t GetByteSize() const;
+    Entity::PointerSize* GetChunkEntities(std::size_t chunk) const;
+    unsigned char* GetChunkColumn(std::size_t chunk, std::size_t column) const;
+
+public:
+    std::size_t AddRow(Entity::PointerSize entityIndex);
+    bool RemoveRow(std::size_t row, Entity::PointerSize& movedEntityIndex);
+    void* GetComponent(std::size_t row, std::size_t column) const;
+    Entity::PointerSize GetEntityIndex(std::size_t row) const;
+    // releases the chunks left empty by removed rows
+    void ShrinkToFit();
+
+private:
+    void Clear();
+
+private:
+    ComponentMask mComponentMask;
+    std::vector<ComponentInfo> mComponentInfos;
+    std::vector<std::ptrdiff_t> mColumns;
+    std::vector<std::size_t> mColumnOffsets;
+    std::size_t mChunkByteSize = ArchetypeChunk::ByteSize;
+    std::size_t mChunkCapacity = 0;
+    std::size_t mSize = 0;
+    std::vector<std::unique_ptr<ArchetypeChunk>> mChunks;
+};
+
+struct EntityLocation final
+{
+    Archetype* mArchetype = nullptr;
+    std::size_t mRow = 0;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// one changed flag per entity index, flags may be set from several threads at once, resizing and clearing may not
+class ChangeSet final
+{
+public:
+    ChangeSet() = default;
+    ChangeSet(ChangeSet&&) = default;
+    ChangeSet& operator=(ChangeSet&&) = default;
+
+public:
+    std::size_t Size() const;
+    std::size_t GetByteSize() const;
+    // grows only, new flags are cleared
+    void Resize(std::size_t size);
+    void Clear();
+
+public:
+    void Set(std::size_t index);
+    bool Test(std::size_t index) const;
+
+private:
+    std::unique_ptr<std::atomic<std::uint8_t>[]> mFlags;
+    std::size_t mSize = 0;
+    std::size_t mCapacity = 0;
+};
+
+inline void ChangeSet::Set(std::size_t index)
+{
+    // skips the store when already set so entities visited by several threads do not bounce cache lines
+    if (mFlags[index].load(std::memory_order_relaxed) == 0)
+    {
+        mFlags[index].store(1, std::memory_order_relaxed);
+    }
+}
+
+inline bool ChangeSet::Test(std::size_t index) const
+{
+    return index < mSize && mFlags[index].load(std::memory_order_relaxed) != 0;
+}
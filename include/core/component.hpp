@@ -2,7 +2,14 @@
 
 #include <memory>
 #include <string>
+#include <bitset>
 #include <iosfwd>
+#include <cstddef>
+#include <type_traits>
+
+#if !defined(ALIVE_ECS_MAX_COMPONENTS)
+#   define ALIVE_ECS_MAX_COMPONENTS 64
+#endif
 
 #define DECLARE_COMPONENT(NAME) static constexpr const char* ComponentName{#NAME}; virtual std::string GetComponentName() const override
 #define DEFINE_COMPONENT(NAME) std::string NAME::GetComponentName() const { return NAME::ComponentName; } constexpr const char* NAME::ComponentName
@@ -13,6 +20,9 @@
 class Entity;
 class EntityManager;
 
+using ComponentTypeId = std::size_t;
+using ComponentMask = std::bitset<ALIVE_ECS_MAX_COMPONENTS>;
+
 class Component
 {
 public:
@@ -25,7 +35,21 @@ public:
 public:
     virtual ~Component() = 0;
 
+public:
+    template<typename C>
+    static ComponentTypeId TypeId();
+    template<typename ...C>
+    static ComponentMask Mask();
+
+private:
+    static ComponentTypeId NextTypeId();
+    template<typename C>
+    static ComponentTypeId UniqueTypeId();
+
 protected:
+    // OnLoad runs once the component is in place and must not rely on other components, OnResolveDependencies runs
+    // after it once the components loaded together are all in place: the entity for AddComponent, the whole batch for
+    // CreateEntitiesWith, Deserialize, LoadSnapshot and ApplyDelta
     virtual void OnLoad();
     virtual void OnResolveDependencies();
 
@@ -37,4 +61,30 @@ protected:
    Entity mEntity;
 };
 
+template<typename C>
+ComponentTypeId Component::TypeId()
+{
+    // const C names the same component, it only asks for read-only access
+    return UniqueTypeId<std::remove_const_t<C>>();
+}
+
+template<typename C>
+ComponentTypeId Component::UniqueTypeId()
+{
+    static const auto typeId = NextTypeId();
+    return typeId;
+}
+
+template<typename ...C>
+ComponentMask Component::Mask()
+{
+    ComponentMask mask;
+    const ComponentTypeId typeIds[] = { 0, Component::TypeId<C>()... };
+    for (std::size_t i = 1; i < sizeof(typeIds) / sizeof(typeIds[0]); i++)
+    {
+        mask.set(typeIds[i]);
+    }
+    return mask;
+}
+
 #undef DECLARE_ROOT_COMPONENT
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <new>
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+#include "component.hpp"
+
+// eHeap: one allocation per component, pointers stay valid until the component is removed
+// eArchetype: entities sharing the same archetype components are packed in chunks, pointers are invalidated by any structural change
+// eSparseSet: one packed array per component type, pointers are invalidated by adding or removing a component of the same type
+enum class ComponentStorage
+{
+    eHeap,
+    eArchetype,
+    eSparseSet,
+};
+
+struct ComponentInfo final
+{
+    std::string mName;
+    ComponentTypeId mTypeId = 0;
+    ComponentStorage mStorage = ComponentStorage::eHeap;
+    std::size_t mSize = 0;
+    std::size_t mAlignment = 0;
+    std::unique_ptr<Component> (* mCreate)() = nullptr;
+    Component* (* mConstruct)(void* memory) = nullptr;
+    Component* (* mGet)(void* memory) = nullptr;
+    void (* mRelocate)(void* destination, void* source) = nullptr;
+    void (* mDestroy)(void* memory) = nullptr;
+    // copy constructs source into memory, nullptr when the component is not copy constructible
+    Component* (* mCopy)(void* memory, const Component* source) = nullptr;
+    // trivially copyable data saved and loaded with a memcpy instead of Serialize and Deserialize, mDataSize is 0 without one
+    std::size_t mDataSize = 0;
+    void* (* mGetData)(Component* component) = nullptr;
+    // false when Serialize writes nothing, set on registration
+    bool mSerialized = true;
+};
+
+// a component opts into bulk serialization with a static SerializedData() returning a pointer to a trivially copyable data member
+template<typename C>
+auto SetComponentData(ComponentInfo& info, int) -> decltype(C::SerializedData(), void())
+{
+    using Data = std::remove_reference_t<decltype(std::declval<C&>().*C::SerializedData())>;
+    static_assert(std::is_trivially_copyable<Data>::value, "SerializedData must point to trivially copyable data");
+    info.mDataSize = sizeof(Data);
+    info.mGetData = [](Component* component) -> void*
+    {
+        return &(static_cast<C*>(component)->*C::SerializedData());
+    };
+}
+
+template<typename C>
+void SetComponentData(ComponentInfo&, long)
+{
+
+}
+
+template<typename C>
+std::enable_if_t<std::is_copy_constructible<C>::value> SetComponentCopy(ComponentInfo& info)
+{
+    info.mCopy = [](void* memory, const Component* source) -> Component*
+    {
+        return new(memory) C(*static_cast<const C*>(source));
+    };
+}
+
+template<typename C>
+std::enable_if_t<!std::is_copy_constructible<C>::value> SetComponentCopy(ComponentInfo&)
+{
+
+}
+
+template<typename C>
+ComponentInfo MakeComponentInfo(ComponentStorage storage)
+{
+    ComponentInfo info;
+    info.mName = C::ComponentName;
+    info.mTypeId = Component::TypeId<C>();
+    info.mStorage = storage;
+    info.mSize = sizeof(C);
+    info.mAlignment = alignof(C);
+    info.mCreate = []() -> std::unique_ptr<Component>
+    {
+        return std::make_unique<C>();
+    };
+    info.mConstruct = [](void* memory) -> Component*
+    {
+        return new(memory) C();
+    };
+    info.mGet = [](void* memory) -> Component*
+    {
+        return static_cast<C*>(memory);
+    };
+    info.mRelocate = [](void* destination, void* source)
+    {
+        new(destination) C(std::move(*static_cast<C*>(source)));
+        static_cast<C*>(source)->~C();
+    };
+    info.mDestroy = [](void* memory)
+    {
+        static_cast<C*>(memory)->~C();
+    };
+    SetComponentData<C>(info, 0);
+    SetComponentCopy<C>(info);
+    return info;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+#include "entity.hpp"
+#include "componentinfo.hpp"
+
+// caller-owned memory that component pools carve their slabs from before falling back to the global heap
+class ComponentArena final
+{
+public:
+    ComponentArena(void* memory, std::size_t byteSize);
+
+public:
+    ComponentArena(const ComponentArena&) = delete;
+    ComponentArena& operator=(const ComponentArena&) = delete;
+
+public:
+    void* Allocate(std::size_t byteSize, std::size_t alignment);
+    std::size_t GetByteSize() const;
+    std::size_t GetUsedByteSize() const;
+
+private:
+    unsigned char* mMemory = nullptr;
+    std::size_t mByteSize = 0;
+    std::size_t mOffset = 0;
+};
+
+// fixed-size slots for one component type, freed slots are chained in a free list and reused first
+class ComponentPool final
+{
+public:
+    static constexpr std::size_t SlabByteSize = 16 * 1024;
+
+public:
+    explicit ComponentPool(const ComponentInfo& componentInfo);
+
+public:
+    ComponentPool(const ComponentPool&) = delete;
+    ComponentPool& operator=(const ComponentPool&) = delete;
+
+public:
+    void SetArena(ComponentArena* arena);
+    std::size_t Size() const;
+    std::size_t GetCapacity() const;
+    std::size_t GetByteSize() const;
+
+public:
+    void* Allocate();
+    void Free(void* slot);
+    void Clear();
+    void Reserve(std::size_t capacity);
+    // releases the heap slabs holding no live component, arena slabs stay since the arena cannot take memory back
+    void ShrinkToFit();
+
+private:
+    void AddSlab();
+
+private:
+    struct FreeSlot
+    {
+        FreeSlot* mNext;
+    };
+
+private:
+    std::size_t mSlotSize = 0;
+    std::size_t mSlabSlots = 0;
+    std::size_t mSize = 0;
+    FreeSlot* mFreeSlots = nullptr;
+    ComponentArena* mArena = nullptr;
+    std::vector<unsigned char*> mSlabs;
+    std::vector<std::unique_ptr<unsigned char[]>> mHeapSlabs;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <iosfwd>
+#include <cstddef>
+
+#include "snapshot.hpp"
+
+class JobSystem;
+
+enum class SnapshotCompression
+{
+    eNone,
+    eBlock,
+};
+
+// LZ77 codec in the spirit of LZ4: sequences of literals followed by a match copied from at most 64KB back,
+// a block never refers to another one so blocks decode independently
+std::size_t GetCompressedBlockBound(std::size_t byteSize);
+// destination holds at least GetCompressedBlockBound(byteSize) bytes, returns the compressed size
+std::size_t CompressBlock(const char* source, std::size_t byteSize, char* destination);
+// throws unless source decodes to exactly byteSize bytes
+void DecompressBlock(const char* source, std::size_t compressedByteSize, char* destination, std::size_t byteSize);
+
+// compressed snapshot: header, table of block sizes then the blocks, blocks that do not shrink are stored as is
+bool IsCompressedSnapshot(const char* magic, std::size_t byteSize);
+void WriteCompressedSnapshot(const std::string& snapshot, std::ostream& os);
+// reads the rest of a compressed snapshot whose magic was already read, blocks are decompressed on the job system when given one
+std::unique_ptr<SnapshotReader> ReadCompressedSnapshot(SnapshotReader& reader, JobSystem* jobSystem);
@@ -1,19 +1,50 @@
 #pragma once
 
+#include <limits>
 #include <memory>
+#include <cstdint>
 #include <vector>
-#include <functional>
 #include <type_traits>
 
+#if !defined(ALIVE_ECS_ENTITY_POINTER_BITS)
+#   define ALIVE_ECS_ENTITY_POINTER_BITS 32
+#endif
+
 class EntityManager;
+class EntityCommandBuffer;
+
+// index and version width of an entity handle, selected by ALIVE_ECS_ENTITY_POINTER_BITS
+template<std::size_t Bits>
+struct EntityPointerTraits;
+template<>
+struct EntityPointerTraits<16>
+{
+    using PointerSize = std::uint16_t;
+};
+template<>
+struct EntityPointerTraits<32>
+{
+    using PointerSize = std::uint32_t;
+};
+template<>
+struct EntityPointerTraits<64>
+{
+    using PointerSize = std::uint64_t;
+};
 
 class Entity final
 {
 public:
     friend EntityManager;
+    friend EntityCommandBuffer;
 
 public:
-    using PointerSize = std::uint16_t;
+    using PointerSize = EntityPointerTraits<ALIVE_ECS_ENTITY_POINTER_BITS>::PointerSize;
+
+public:
+    // the last index is never handed out, a slot whose version reaches MaxVersion is retired instead of wrapping
+    static constexpr PointerSize MaxIndex = std::numeric_limits<PointerSize>::max();
+    static constexpr PointerSize MaxVersion = std::numeric_limits<PointerSize>::max();
 
 public:
     Entity() = default;
@@ -48,10 +79,10 @@ public:
     bool HasAnyComponent() const;
 
 public:
-    template<typename ...C>
-    bool Any(typename std::common_type<std::function<void(C* ...)>>::type view);
-    template<typename ...C>
-    bool With(typename std::common_type<std::function<void(C* ...)>>::type view);
+    template<typename ...C, typename F>
+    bool Any(F&& view);
+    template<typename ...C, typename F>
+    bool With(F&& view);
 
 public:
     void ResolveComponentDependencies();
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include "entity.hpp"
+#include "entitymanager.hpp"
+
+// records structural changes, from any number of threads at once, and applies them later in one pass
+// commands targeting an entity that is no longer valid when played back are skipped, as are adding a component
+// the entity already has and removing one it does not have, so concurrent jobs may record the same change twice
+class EntityCommandBuffer final
+{
+public:
+    explicit EntityCommandBuffer(EntityManager& manager);
+
+public:
+    EntityCommandBuffer(const EntityCommandBuffer&) = delete;
+    EntityCommandBuffer& operator=(const EntityCommandBuffer&) = delete;
+
+public:
+    template<typename ...C>
+    void CreateEntityWith();
+    // init receives the created entity during playback
+    template<typename ...C, typename F>
+    void CreateEntityWith(F&& init);
+    void DestroyEntity(const Entity& entityPointer);
+    template<typename C>
+    void AddComponent(const Entity& entityPointer);
+    // init receives the added component during playback
+    template<typename C, typename F>
+    void AddComponent(const Entity& entityPointer, F&& init);
+    template<typename C>
+    void RemoveComponent(const Entity& entityPointer);
+
+public:
+    // applies every recorded command grouped by entity, keeping the order each thread recorded them in for an entity,
+    // then creates the recorded entities; must not run concurrently with recording or with an iteration of the manager
+    void Playback();
+    std::size_t Size() const;
+    bool IsEmpty() const;
+    void Clear();
+
+private:
+    enum class CommandType
+    {
+        eDestroy,
+        eApply,
+        eCreate,
+    };
+
+    struct Command
+    {
+        CommandType mType;
+        Entity mEntity;
+        std::function<void(Entity&)> mApply;
+    };
+
+    using CommandList = std::vector<Command>;
+
+private:
+    CommandList& GetThreadCommands();
+    void Record(CommandType type, const Entity& entityPointer, std::function<void(Entity&)> apply);
+
+private:
+    EntityManager& mManager;
+    std::uint64_t mSerial;
+    mutable std::mutex mMutex;
+    std::unordered_map<std::thread::id, std::unique_ptr<CommandList>> mThreadCommands;
+};
+
+template<typename... C>
+void EntityCommandBuffer::CreateEntityWith()
+{
+    CreateEntityWith<C...>([](Entity&)
+                           {
+                           });
+}
+
+template<typename... C, typename F>
+void EntityCommandBuffer::CreateEntityWith(F&& init)
+{
+    Record(CommandType::eCreate, Entity(), [init = std::forward<F>(init)](Entity& entityPointer)
+    {
+        using Expand = int[];
+        (void) Expand{ 0, (entityPointer.AddComponent<C>(), 0)... };
+        entityPointer.ResolveComponentDependencies();
+        init(entityPointer);
+    });
+}
+
+template<typename C>
+void EntityCommandBuffer::AddComponent(const Entity& entityPointer)
+{
+    AddComponent<C>(entityPointer, [](C*)
+    {
+    });
+}
+
+template<typename C, typename F>
+void EntityCommandBuffer::AddComponent(const Entity& entityPointer, F&& init)
+{
+    Record(CommandType::eApply, entityPointer, [init = std::forward<F>(init)](Entity& target)
+    {
+        if (!target.HasComponent<C>())
+        {
+            init(target.AddComponent<C>());
+        }
+    });
+}
+
+template<typename C>
+void EntityCommandBuffer::RemoveComponent(const Entity& entityPointer)
+{
+    Record(CommandType::eApply, entityPointer, [](Entity& target)
+    {
+        if (target.HasComponent<C>())
+        {
+            target.RemoveComponent<C>();
+        }
+    });
+}
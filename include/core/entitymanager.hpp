@@ -1,31 +1,59 @@
 #pragma once
 
+#include <array>
 #include <memory>
 #include <vector>
+#include <tuple>
 #include <string>
 #include <iosfwd>
+#include <mutex>
+#include <future>
 #include <utility>
+#include <cstddef>
+#include <cstdint>
 #include <stdexcept>
 #include <algorithm>
-#include <functional>
 #include <type_traits>
 #include <unordered_map>
 
 #include "system.hpp"
 #include "entity.hpp"
 #include "component.hpp"
+#include "archetype.hpp"
+#include "sparseset.hpp"
+#include "entityquery.hpp"
+#include "jobsystem.hpp"
+#include "memorystats.hpp"
+#include "snapshot.hpp"
+#include "changeset.hpp"
+#include "compression.hpp"
+#include "componentpool.hpp"
+#include "componentinfo.hpp"
 
 class EntityManager final
 {
 public:
     friend Entity;
 
+public:
+    EntityManager() = default;
+    ~EntityManager();
+
+public:
+    EntityManager(const EntityManager&) = delete;
+    EntityManager& operator=(const EntityManager&) = delete;
+
 public:
     Entity CreateEntity();
     template<typename ...C>
     Entity CreateEntityWith();
+    // appends count new entities to entityPointers, storage is reserved once and OnLoad then OnResolveDependencies
+    // run for the whole batch after every component is constructed
+    template<typename ...C>
+    void CreateEntitiesWith(std::size_t count, std::vector<Entity>& entityPointers);
 
 private:
+    void CreateEntities(std::size_t count, const ComponentTypeId* typeIds, std::size_t typeCount, std::vector<Entity>& entityPointers);
     template<typename C>
     void CreateEntityWith(Entity& entityPointer);
     template<typename C1, typename C2, typename ...C>
@@ -35,6 +63,19 @@ private:
     void DestroyEntity(Entity& entityPointer);
 
 public:
+    // releases storage one component type at a time, throws before destroying anything if an entity is invalid,
+    // an entity listed twice is destroyed once
+    void DestroyEntities(const std::vector<Entity>& entityPointers);
+    template<typename It>
+    void DestroyEntities(It first, It last);
+    template<typename ...C>
+    void DestroyWith();
+
+private:
+    void DestroyEntityIndexes(std::vector<Entity::PointerSize>& indexes);
+
+public:
+    // systems are looked up by static type id in constant time, returned pointers stay valid until the system is removed
     template<typename S, typename ...Args>
     S* AddSystem(Args&& ...args);
     template<typename S>
@@ -48,36 +89,145 @@ public:
 
 private:
     void ConstructSystem(System* component);
+    template<typename S>
+    static auto GetSystemReadComponents(int) -> decltype(S::ReadComponents());
+    template<typename S>
+    static ComponentMask GetSystemReadComponents(long);
+    template<typename S>
+    static auto GetSystemWriteComponents(int) -> decltype(S::WriteComponents());
+    template<typename S>
+    static ComponentMask GetSystemWriteComponents(long);
+    template<typename S>
+    static auto IsSystemAccessDeclared(int) -> decltype(S::ReadComponents(), bool{});
+    template<typename S>
+    static auto IsSystemAccessDeclared(long) -> decltype(S::WriteComponents(), bool{});
+    template<typename S>
+    static bool IsSystemAccessDeclared(...);
 
 public:
     void ResolveSystemDependencies();
+    // runs OnUpdate of every system on the job system, systems run concurrently unless one writes components
+    // the other reads or writes or one asked to update after the other, otherwise they keep the order they were added in
+    // a system declaring neither Reads nor Writes runs alone, OnUpdate must not create or destroy entities or add or
+    // remove components, it records them in an EntityCommandBuffer that is played back once Update returned
+    void Update(float dt);
+
+private:
+    std::vector<std::size_t> GetSystemUpdateOrder() const;
 
 public:
     template<typename C>
-    void RegisterComponent();
+    void RegisterComponent(ComponentStorage storage = ComponentStorage::eHeap);
 #if defined(_DEBUG)
     bool IsComponentRegistered(const std::string& componentName) const;
     void AssertComponentRegistered(const std::string& componentName) const;
 #endif
 
 public:
+    // heap components are carved from the arena until it runs out, the arena must outlive the manager
+    void SetComponentArena(ComponentArena* arena);
+
+private:
+    void RegisterComponent(ComponentInfo info);
+    bool IsComponentRegistered(ComponentTypeId typeId) const;
     template<typename ...C>
-    void Any(typename std::common_type<std::function<void(Entity, C* ...)>>::type view);
+    static const ComponentMask& GetComponentMask();
+    template<typename C>
+    ComponentTypeId GetRegisteredTypeId();
+    template<typename C>
+    static auto IsComponentSerialized(int) -> decltype(&C::Serialize, bool());
+    template<typename C>
+    static bool IsComponentSerialized(long);
+
+public:
+    template<typename ...C, typename F>
+    void Any(F&& view);
     template<typename ...C>
     std::vector<Entity> Any();
-    template<typename ...C>
-    void With(typename std::common_type<std::function<void(Entity, C* ...)>>::type view);
+    template<typename ...C, typename F>
+    void With(F&& view);
     template<typename ...C>
     std::vector<Entity> With();
 
+private:
+    // same traversal as With without marking the visited components as changed
+    template<typename ...C, typename F>
+    void VisitWith(F&& view);
+
 public:
-    void Serialize(std::ostream& os) const;
+    // runs view concurrently on the job system, one call per matching entity, returns once every call returned
+    // inside view it is safe to read and write the components passed to it and to read any other component or entity,
+    // creating or destroying entities, adding or removing components and adding or removing systems is not
+    template<typename ...C, typename F>
+    void ParallelWith(F&& view);
+    // same as ParallelWith without waiting, no structural change may happen before the handle is done
+    template<typename ...C, typename F>
+    JobHandle ScheduleWith(F&& view);
+    // 0 uses one thread per hardware thread, the calling thread counts as one of them
+    // jobs still queued on the previous job system run on the calling thread before it is destroyed, the handles it
+    // returned are invalidated, they only report IsDone and their exceptions are lost, never call this from a job
+    void SetWorkerThreadCount(std::size_t threadCount);
+    JobSystem& GetJobSystem();
+
+public:
+    // binary snapshot in native byte order: header, entity slots, component name table then one block per component type
+    // holding the indexes of its entities followed by their data, see SerializedData in componentinfo.hpp for the bulk path
+    // eBlock compresses the snapshot in blocks that Deserialize and LoadSnapshot recognize and decompress on the job system
+    void Serialize(std::ostream& os, SnapshotCompression compression = SnapshotCompression::eNone) const;
+    // copies the world on the calling thread then serializes and writes it to os on a background thread, os must outlive the
+    // returned future, the copy must not overlap a ParallelWith or a system update, any change made after the call returns
+    // is not saved, Serialize of a copy constructible component without SerializedData runs on a copy of it in the background
+    // and must only read that component, the other components are still serialized on the calling thread
+    std::future<void> SerializeAsync(std::ostream& os, SnapshotCompression compression = SnapshotCompression::eNone) const;
     void Deserialize(std::istream& is);
+    // maps a file written by Serialize, or decompresses it whole, entities and archetype components are loaded right away,
+    // the other components of a type are built, and their OnLoad called, on the first access to that type
+    void LoadSnapshot(const std::string& path);
+    // runs the OnLoad then the OnResolveDependencies pass of snapshot components on the job system, the callbacks may then
+    // read any component but only write their own, and the first access to a type not built yet builds every type,
+    // the archetype components LoadSnapshot builds right away still load on the calling thread while other types are pending
+    void SetParallelSnapshotLoad(bool parallel);
+
+private:
+    // deferred leaves the payloads that Serialize writes to EncodeSnapshot, holding copies of the components instead
+    void CaptureSnapshot(SnapshotImage& image, bool deferred) const;
+    static void EncodeSnapshot(SnapshotImage& image);
+    static void WriteSnapshot(const SnapshotImage& image, std::ostream& os, SnapshotCompression compression);
+    std::unique_ptr<SnapshotReader> ReadSnapshot(std::unique_ptr<SnapshotReader> reader);
+    void ReadSnapshotEntities(SnapshotReader& reader);
+    void WriteComponentNames(std::ostream& os, const std::vector<ComponentTypeId>& typeIds) const;
+    std::vector<ComponentTypeId> ReadComponentNames(SnapshotReader& reader) const;
+    void SerializeComponents(ComponentTypeId typeId, const std::vector<Entity::PointerSize>& indexes, std::string& payload) const;
+    void BuildSnapshotComponents(const ComponentMask& componentMask);
+    void RequireComponents(const ComponentMask& componentMask) const;
+
+public:
+    // a component counts as changed once it is added, removed or reached through a non-const accessor (GetComponent, Any, With,
+    // ParallelWith, views and queries), writes through pointers kept from before the last ClearChanges are not seen,
+    // passing const C to those accessors, as in With<const C>, reaches C read-only and leaves it unchanged
+    void ClearChanges();
+    // writes the entities created or destroyed and the components changed since the last ClearChanges, Clear, Deserialize,
+    // LoadSnapshot or ApplyDelta, in the snapshot byte order
+    void SerializeDelta(std::ostream& os) const;
+    // replays a delta on a world holding the state it was recorded from, OnLoad then OnResolveDependencies run for the
+    // components it adds, a corrupted delta leaves the world cleared
+    void ApplyDelta(std::istream& is);
+
+private:
+    void ReadDelta(SnapshotReader& reader);
+    void ResizeChangeSets();
+    template<typename ...C>
+    void MarkComponentsChanged(Entity::PointerSize index);
 
 private:
     bool IsEntityPointerValid(const Entity& entityPointer) const;
     void AssertEntityPointerValid(const Entity& entityPointer) const;
 
+private:
+    void SetEntityAlive(Entity::PointerSize index, bool alive);
+    std::size_t FindAliveIndex(std::size_t index) const;
+    static std::size_t CountTrailingZeros(std::uint64_t bits);
+
 public:
     template<bool is_const>
     class EntityComponentContainerIterator final
@@ -116,10 +266,7 @@ public:
     private:
         void IterateToNextValidEntity()
         {
-            while (mIndex < mManager.mNextIndex && std::find(mManager.mFreeIndexes.begin(), mManager.mFreeIndexes.end(), mIndex) != mManager.mFreeIndexes.end())
-            {
-                mIndex += 1;
-            }
+            mIndex = static_cast<Entity::PointerSize>(mManager.FindAliveIndex(mIndex));
             if (mIndex < mManager.mNextIndex)
             {
                 mVersion = mManager.mVersions[mIndex];
@@ -142,10 +289,207 @@ public:
     ConstIterator begin() const;
     ConstIterator end() const;
 
+public:
+    template<typename ...C>
+    class EntityView final
+    {
+    public:
+        friend EntityManager;
+
+    public:
+        class ViewIterator final
+        {
+        public:
+            friend EntityView;
+
+        public:
+            std::tuple<Entity, C& ...> operator*()
+            {
+                const auto index = static_cast<Entity::PointerSize>(mIndex);
+                mManager->MarkComponentsChanged<C...>(index);
+                return std::tuple<Entity, C& ...>(Entity(mManager, index, mManager->mVersions[index]), *mManager->GetStoredComponent<C>(index)...);
+            }
+            bool operator!=(const ViewIterator& other)
+            {
+                return mIndex != other.mIndex;
+            }
+            const ViewIterator& operator++()
+            {
+                mIndex += 1;
+                IterateToNextMatchingEntity();
+                return *this;
+            }
+
+        private:
+            ViewIterator(EntityManager* manager, std::size_t index) : mManager(manager), mIndex(index)
+            {
+                IterateToNextMatchingEntity();
+            }
+
+        private:
+            void IterateToNextMatchingEntity()
+            {
+                const auto& componentMask = GetComponentMask<C...>();
+                mIndex = mManager->FindAliveIndex(mIndex);
+                while (mIndex < mManager->mVersions.size() && (mManager->mSignatures[mIndex] & componentMask) != componentMask)
+                {
+                    mIndex = mManager->FindAliveIndex(mIndex + 1);
+                }
+            }
+
+        private:
+            EntityManager* mManager = nullptr;
+            std::size_t mIndex = 0;
+        };
+
+    public:
+        // fastest way to visit the view, uses the same storage aware paths as EntityManager::With
+        template<typename F>
+        void Each(F&& view)
+        {
+            mManager.template With<C...>([&view](Entity entityPointer, C* ...components)
+            {
+                view(entityPointer, *components...);
+            });
+        }
+
+    public:
+        ViewIterator begin()
+        {
+            mManager.RequireComponents(GetComponentMask<C...>());
+            return { &mManager, 0 };
+        }
+        ViewIterator end()
+        {
+            return { &mManager, mManager.mVersions.size() };
+        }
+
+    private:
+        explicit EntityView(EntityManager& manager) : mManager(manager)
+        {
+        }
+
+    private:
+        EntityManager& mManager;
+    };
+
+public:
+    template<typename ...C>
+    EntityView<C...> View();
+
+public:
+    template<typename ...C>
+    class QueryView final
+    {
+    public:
+        friend EntityManager;
+
+    public:
+        class QueryIterator final
+        {
+        public:
+            friend QueryView;
+
+        public:
+            std::tuple<Entity, C& ...> operator*()
+            {
+                const auto index = mQuery->GetEntities()[mPosition];
+                mManager->MarkComponentsChanged<C...>(index);
+                return std::tuple<Entity, C& ...>(Entity(mManager, index, mManager->mVersions[index]), *mManager->GetStoredComponent<C>(index)...);
+            }
+            bool operator!=(const QueryIterator& other)
+            {
+                return mPosition != other.mPosition;
+            }
+            const QueryIterator& operator++()
+            {
+                mPosition += 1;
+                return *this;
+            }
+
+        private:
+            QueryIterator(EntityManager* manager, const EntityQuery* query, std::size_t position) : mManager(manager), mQuery(query), mPosition(position)
+            {
+            }
+
+        private:
+            EntityManager* mManager = nullptr;
+            const EntityQuery* mQuery = nullptr;
+            std::size_t mPosition = 0;
+        };
+
+    public:
+        // visits only the matching entities, the membership is kept up to date by every structural change
+        template<typename F>
+        void Each(F&& view)
+        {
+            mManager.RequireComponents(GetComponentMask<C...>());
+            const auto entities = mQuery->GetEntities();
+            for (std::size_t position = 0; position < mQuery->Size(); position++)
+            {
+                const auto index = entities[position];
+                mManager.MarkComponentsChanged<C...>(index);
+                view(Entity(&mManager, index, mManager.mVersions[index]), *mManager.GetStoredComponent<C>(index)...);
+            }
+        }
+        std::size_t Size() const
+        {
+            return mQuery->Size();
+        }
+
+    public:
+        QueryIterator begin()
+        {
+            mManager.RequireComponents(GetComponentMask<C...>());
+            return { &mManager, mQuery, 0 };
+        }
+        QueryIterator end()
+        {
+            return { &mManager, mQuery, mQuery->Size() };
+        }
+
+    private:
+        QueryView(EntityManager& manager, const EntityQuery* query) : mManager(manager), mQuery(query)
+        {
+        }
+
+    private:
+        EntityManager& mManager;
+        const EntityQuery* mQuery;
+    };
+
+public:
+    template<typename ...C>
+    QueryView<C...> Query();
+
+private:
+    EntityQuery* GetOrCreateQuery(const ComponentMask& componentMask);
+    void UpdateQueries(Entity::PointerSize index);
+
 public:
     void Clear();
     std::size_t Size() const;
 
+public:
+    // entity slots usable before the per-entity tables grow again
+    std::size_t Capacity() const;
+    template<typename C>
+    std::size_t ComponentCapacity() const;
+    // pre-sizes the per-entity tables so creating up to entityCount entities does not reallocate them
+    void Reserve(std::size_t entityCount);
+    // also pre-sizes the storage of each given component type, archetype components are sized per archetype and are skipped
+    template<typename ...C>
+    void Reserve(std::size_t entityCount, const std::array<std::size_t, sizeof...(C)>& componentCounts);
+    // drops the dead slots after the last alive entity, returns the unused capacity of every table and the empty pool slabs and archetype chunks
+    void ShrinkToFit();
+    MemoryStats GetMemoryStats() const;
+    // same as GetMemoryStats reusing the allocations of stats, meant to be called every frame
+    void GetMemoryStats(MemoryStats& stats) const;
+
+private:
+    void ReserveComponents(ComponentTypeId typeId, std::size_t componentCount);
+    std::size_t GetComponentCapacity(ComponentTypeId typeId) const;
+
 private:
     template<typename C>
     C* EntityGetComponent(const Entity& entityPointer);
@@ -158,7 +502,33 @@ private:
 
 private:
     void EntityConstructComponent(Component* component, const Entity& entityPointer);
+    // same as EntityConstructComponent without resolving, batches resolve once every component is loaded
+    void EntityLoadComponent(Component* component, const Entity& entityPointer);
     void EntityResolveComponentDependencies(const Entity& entityPointer);
+    template<typename F>
+    void EntityForEachComponent(Entity::PointerSize index, F&& f) const;
+    template<typename F>
+    void EntityForEachComponent(Entity::PointerSize index, const ComponentMask& componentMask, F&& f) const;
+    template<typename C>
+    C* GetStoredComponent(Entity::PointerSize index) const;
+    Component* GetStoredComponent(Entity::PointerSize index, ComponentTypeId typeId) const;
+    Component* EntityAddStoredComponent(const Entity& entityPointer, const ComponentInfo& componentInfo);
+    void EntityRemoveStoredComponent(const Entity& entityPointer, ComponentTypeId typeId);
+
+private:
+    Archetype* GetOrCreateArchetype(const ComponentMask& componentMask);
+    Component* EntityAddArchetypeComponent(const Entity& entityPointer, ComponentTypeId typeId);
+    void EntityRemoveArchetypeComponent(const Entity& entityPointer, ComponentTypeId typeId);
+    void EntityMoveArchetype(Entity::PointerSize index, Archetype* destination, std::ptrdiff_t skippedColumn);
+    void EntityReleaseArchetypeRow(Entity::PointerSize index);
+    void EntityReleaseHeapComponent(Entity::PointerSize index, ComponentTypeId typeId);
+    void ClearHeapComponents();
+
+private:
+    template<typename ...C, typename F, std::size_t ...I>
+    void ArchetypeWith(const Archetype& archetype, const ComponentMask& componentMask, F& view, std::index_sequence<I...>);
+    template<typename ...C, typename F, std::size_t ...I>
+    void SparseSetWith(const ComponentSparseSet& sparseSet, const ComponentMask& componentMask, F& view, std::index_sequence<I...>);
 
 private:
     template<typename C>
@@ -171,20 +541,97 @@ private:
     bool EntityHasAnyComponent(const Entity& entityPointer) const;
 
 private:
-    template<typename ...C>
-    bool EntityAny(const Entity& entityPointer, typename std::common_type<std::function<void(C* ...)>>::type view);
-    template<typename ...C>
-    bool EntityWith(const Entity& entityPointer, typename std::common_type<std::function<void(C* ...)>>::type view);
+    template<typename ...C, typename F>
+    bool EntityAny(const Entity& entityPointer, F&& view);
+    template<typename ...C, typename F>
+    bool EntityWith(const Entity& entityPointer, F&& view);
 
 private:
     Entity::PointerSize mNextIndex = 0;
+    Entity::PointerSize mFirstVersion = 1; // version of never used slots, stays above the versions of trimmed slots
     std::vector<Entity::PointerSize> mVersions;
     std::vector<Entity::PointerSize> mFreeIndexes;
-    std::vector<std::unique_ptr<System>> mSystems;
-    std::vector<std::vector<std::unique_ptr<Component>>> mEntityComponents;
-    std::unordered_map<std::string, std::function<std::unique_ptr<Component>()>> mRegisteredComponents;
+    std::vector<ComponentMask> mSignatures;
+    std::vector<std::uint64_t> mAliveEntities;
+    std::size_t mAliveCount = 0; // bits set in mAliveEntities, retired slots are neither alive nor free
+    std::vector<std::unique_ptr<System>> mSystems; // update order
+    std::vector<System*> mSystemsByType; // [system type id]
+    std::vector<std::vector<void*>> mHeapComponents; // [type id][entity index]
+    std::vector<std::unique_ptr<ComponentPool>> mComponentPools; // [type id]
+    ComponentArena* mComponentArena = nullptr;
+    std::unique_ptr<JobSystem> mJobSystem;
+    std::vector<EntityLocation> mEntityLocations;
+    std::vector<std::unique_ptr<Archetype>> mArchetypes;
+    std::unordered_map<ComponentMask, Archetype*> mArchetypesByComponents;
+    std::vector<ComponentInfo> mComponentInfos; // [type id]
+    std::unique_ptr<SnapshotReader> mSnapshotReader; // owns the blocks of mSnapshotComponents
+    std::vector<SnapshotBlock> mSnapshotBlocks; // [type id]
+    ComponentMask mSnapshotComponents; // types read from a snapshot and not built yet
+    bool mParallelSnapshotLoad = false;
+    ChangeSet mChangedEntities; // [entity index] created or destroyed since the last ClearChanges
+    std::vector<ChangeSet> mChangedComponents; // [type id][entity index]
+    std::vector<std::unique_ptr<ComponentSparseSet>> mSparseSets; // [type id]
+    ComponentMask mArchetypeComponents;
+    ComponentMask mSparseSetComponents;
+    std::vector<std::unique_ptr<EntityQuery>> mQueries;
+    std::unordered_map<ComponentMask, EntityQuery*> mQueriesByComponents;
+    std::mutex mQueriesMutex; // systems create queries concurrently during Update
+    std::unordered_map<std::string, ComponentTypeId> mRegisteredComponents;
 };
 
+inline std::size_t EntityManager::FindAliveIndex(std::size_t index) const
+{
+    const auto size = mVersions.size();
+    if (index >= size)
+    {
+        return size;
+    }
+    auto word = index / 64;
+    auto bits = mAliveEntities[word] & (~std::uint64_t{ 0 } << (index % 64));
+    while (bits == 0)
+    {
+        // skips 64 dead slots at once
+        if (++word == mAliveEntities.size())
+        {
+            return size;
+        }
+        bits = mAliveEntities[word];
+    }
+    return word * 64 + CountTrailingZeros(bits);
+}
+
+inline std::size_t EntityManager::CountTrailingZeros(std::uint64_t bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<std::size_t>(__builtin_ctzll(bits));
+#else
+    std::size_t count = 0;
+    while ((bits & 1) == 0)
+    {
+        bits >>= 1;
+        count += 1;
+    }
+    return count;
+#endif
+}
+
+inline void EntityManager::RequireComponents(const ComponentMask& componentMask) const
+{
+    // building does not change what callers can observe, so it is fine behind const accessors,
+    // callbacks running in parallel must not build a type themselves so a parallel load builds every pending type at once
+    if ((mSnapshotComponents & componentMask).any())
+    {
+        const_cast<EntityManager*>(this)->BuildSnapshotComponents(mParallelSnapshotLoad ? mSnapshotComponents : componentMask);
+    }
+}
+
+template<typename ...C>
+void EntityManager::MarkComponentsChanged(Entity::PointerSize index)
+{
+    const int expand[] = { 0, (std::is_const<C>::value ? 0 : (mChangedComponents[Component::TypeId<C>()].Set(index), 0))... };
+    static_cast<void>(expand);
+}
+
 template<typename C>
 C* Entity::GetComponent()
 {
@@ -194,7 +641,7 @@ C* Entity::GetComponent()
 template<typename C>
 const C* Entity::GetComponent() const
 {
-    return mManager->EntityGetComponent<C>(*this);
+    return static_cast<const EntityManager*>(mManager)->EntityGetComponent<C>(*this);
 }
 
 template<typename C>
@@ -233,16 +680,16 @@ bool Entity::HasAnyComponent() const
     return mManager->EntityHasAnyComponent<C1, C2, C...>(*this);
 }
 
-template<typename... C>
-bool Entity::Any(typename std::common_type<std::function<void(C* ...)>>::type view)
+template<typename... C, typename F>
+bool Entity::Any(F&& view)
 {
-    return mManager->template EntityAny<C...>(*this, view);
+    return mManager->template EntityAny<C...>(*this, std::forward<F>(view));
 }
 
-template<typename... C>
-bool Entity::With(typename std::common_type<std::function<void(C* ...)>>::type view)
+template<typename... C, typename F>
+bool Entity::With(F&& view)
 {
-    return mManager->template EntityWith<C...>(*this, view);
+    return mManager->template EntityWith<C...>(*this, std::forward<F>(view));
 }
 
 template<typename... C>
@@ -254,6 +701,13 @@ Entity EntityManager::CreateEntityWith()
     return entityPointer;
 }
 
+template<typename... C>
+void EntityManager::CreateEntitiesWith(std::size_t count, std::vector<Entity>& entityPointers)
+{
+    const ComponentTypeId typeIds[] = { 0, GetRegisteredTypeId<C>()... };
+    CreateEntities(count, typeIds + 1, sizeof...(C), entityPointers);
+}
+
 template<typename C>
 void EntityManager::CreateEntityWith(Entity& entityPointer)
 {
@@ -267,6 +721,40 @@ void EntityManager::CreateEntityWith(Entity& entityPointer)
     CreateEntityWith<C2, C...>(entityPointer);
 }
 
+template<typename It>
+void EntityManager::DestroyEntities(It first, It last)
+{
+    for (auto it = first; it != last; ++it)
+    {
+        AssertEntityPointerValid(*it);
+    }
+    std::vector<Entity::PointerSize> indexes;
+    for (auto it = first; it != last; ++it)
+    {
+        if (FindAliveIndex(it->mIndex) == it->mIndex)
+        {
+            SetEntityAlive(it->mIndex, false);
+            indexes.emplace_back(it->mIndex);
+        }
+    }
+    DestroyEntityIndexes(indexes);
+}
+
+template<typename... C>
+void EntityManager::DestroyWith()
+{
+    std::vector<Entity::PointerSize> indexes;
+    VisitWith<C...>([&indexes](Entity entityPointer, C* ...)
+    {
+        indexes.emplace_back(entityPointer.mIndex);
+    });
+    for (auto index : indexes)
+    {
+        SetEntityAlive(index, false);
+    }
+    DestroyEntityIndexes(indexes);
+}
+
 template<typename S, typename... Args>
 S* EntityManager::AddSystem(Args&& ... args)
 {
@@ -276,7 +764,21 @@ S* EntityManager::AddSystem(Args&& ... args)
     }
     auto system = std::make_unique<S>(std::forward<Args>(args)...);
     auto systemPtr = system.get();
+    systemPtr->mReadComponents = GetSystemReadComponents<S>(0);
+    systemPtr->mWriteComponents = GetSystemWriteComponents<S>(0);
+    if (!IsSystemAccessDeclared<S>(0))
+    {
+        // nothing tells what OnUpdate touches, it may write any component
+        systemPtr->mWriteComponents = ~ComponentMask{};
+    }
+    systemPtr->mByteSize = sizeof(S);
     mSystems.emplace_back(std::move(system));
+    const auto typeId = System::TypeId<S>();
+    if (typeId >= mSystemsByType.size())
+    {
+        mSystemsByType.resize(typeId + 1, nullptr);
+    }
+    mSystemsByType[typeId] = systemPtr;
     ConstructSystem(systemPtr);
     return systemPtr;
 }
@@ -290,15 +792,8 @@ S* EntityManager::GetSystem()
 template<typename S>
 const S* EntityManager::GetSystem() const
 {
-    auto found = std::find_if(mSystems.begin(), mSystems.end(), [](const auto& s)
-    {
-        return s->GetSystemName() == S::SystemName;
-    });
-    if (found != mSystems.end())
-    {
-        return static_cast<S*>(found->get());
-    }
-    return nullptr;
+    const auto typeId = System::TypeId<S>();
+    return typeId < mSystemsByType.size() ? static_cast<const S*>(mSystemsByType[typeId]) : nullptr;
 }
 
 template<typename S>
@@ -308,14 +803,12 @@ void EntityManager::RemoveSystem()
     {
         throw std::logic_error(std::string{ "EntityManager::RemoveSystem: System " } + S::SystemName + std::string{ " not found" });
     }
-    auto found = std::find_if(mSystems.begin(), mSystems.end(), [](const auto& s)
-    {
-        return s->GetSystemName() == S::SystemName;
-    });
-    if (found != mSystems.end())
+    auto& system = mSystemsByType[System::TypeId<S>()];
+    mSystems.erase(std::find_if(mSystems.begin(), mSystems.end(), [system](const auto& s)
     {
-        mSystems.erase(found);
-    }
+        return s.get() == system;
+    }));
+    system = nullptr;
 }
 
 template<typename S>
@@ -324,76 +817,179 @@ bool EntityManager::HasSystem()
     return GetSystem<S>() != nullptr;
 }
 
+template<typename S>
+auto EntityManager::GetSystemReadComponents(int) -> decltype(S::ReadComponents())
+{
+    return S::ReadComponents();
+}
+
+template<typename S>
+ComponentMask EntityManager::GetSystemReadComponents(long)
+{
+    return {};
+}
+
+template<typename S>
+auto EntityManager::GetSystemWriteComponents(int) -> decltype(S::WriteComponents())
+{
+    return S::WriteComponents();
+}
+
+template<typename S>
+ComponentMask EntityManager::GetSystemWriteComponents(long)
+{
+    return {};
+}
+
+template<typename S>
+auto EntityManager::IsSystemAccessDeclared(int) -> decltype(S::ReadComponents(), bool{})
+{
+    return true;
+}
+
+template<typename S>
+auto EntityManager::IsSystemAccessDeclared(long) -> decltype(S::WriteComponents(), bool{})
+{
+    return true;
+}
+
+template<typename S>
+bool EntityManager::IsSystemAccessDeclared(...)
+{
+    return false;
+}
+
+template<typename C>
+void EntityManager::RegisterComponent(ComponentStorage storage)
+{
+    auto info = MakeComponentInfo<C>(storage);
+    info.mSerialized = IsComponentSerialized<C>(0);
+    RegisterComponent(std::move(info));
+}
+
 template<typename C>
-void EntityManager::RegisterComponent()
+auto EntityManager::IsComponentSerialized(int) -> decltype(&C::Serialize, bool())
 {
-    mRegisteredComponents[C::ComponentName] = []()
+    // a component keeping the Serialize of Component writes nothing, its payload is known without visiting it
+    return !std::is_same<decltype(&C::Serialize), void (Component::*)(std::ostream&) const>::value;
+}
+
+template<typename C>
+bool EntityManager::IsComponentSerialized(long)
+{
+    return true;
+}
+
+template<typename C>
+ComponentTypeId EntityManager::GetRegisteredTypeId()
+{
+    const auto typeId = Component::TypeId<C>();
+    if (!IsComponentRegistered(typeId))
     {
-        return std::make_unique<C>();
-    };
+#if defined(_DEBUG)
+        AssertComponentRegistered(C::ComponentName);
+#endif
+        RegisterComponent<C>();
+    }
+    return typeId;
+}
+
+template<typename ...C>
+const ComponentMask& EntityManager::GetComponentMask()
+{
+    static const auto componentMask = Component::Mask<C...>();
+    return componentMask;
 }
 
 template<typename C>
 C* EntityManager::EntityGetComponent(const Entity& entityPointer)
 {
-    AssertEntityPointerValid(entityPointer);
-    return const_cast<C*>(static_cast<const EntityManager*>(this)->EntityGetComponent<C>(entityPointer));
+    auto component = const_cast<C*>(static_cast<const EntityManager*>(this)->EntityGetComponent<C>(entityPointer));
+    if (component != nullptr)
+    {
+        MarkComponentsChanged<C>(entityPointer.mIndex);
+    }
+    return component;
 }
 
 template<typename C>
 const C* EntityManager::EntityGetComponent(const Entity& entityPointer) const
 {
     AssertEntityPointerValid(entityPointer);
-    auto& components = mEntityComponents[entityPointer.mIndex];
-    auto found = std::find_if(components.begin(), components.end(), [](const auto& c)
+    const auto typeId = Component::TypeId<C>();
+    if (!mSignatures[entityPointer.mIndex][typeId])
     {
-        return c->GetComponentName() == C::ComponentName;
-    });
-    if (found != components.end())
+        return nullptr;
+    }
+    RequireComponents(GetComponentMask<C>());
+    return GetStoredComponent<C>(entityPointer.mIndex);
+}
+
+template<typename C>
+C* EntityManager::GetStoredComponent(Entity::PointerSize index) const
+{
+    const auto typeId = Component::TypeId<C>();
+    if (mArchetypeComponents[typeId])
+    {
+        const auto& location = mEntityLocations[index];
+        const auto column = static_cast<std::size_t>(location.mArchetype->FindColumn(typeId));
+        return static_cast<C*>(location.mArchetype->GetComponent(location.mRow, column));
+    }
+    if (mSparseSetComponents[typeId])
     {
-        return static_cast<C*>(found->get());
+        return static_cast<C*>(mSparseSets[typeId]->Get(index));
     }
-    return nullptr;
+    return static_cast<C*>(mHeapComponents[typeId][index]);
 }
 
 template<typename C>
 C* EntityManager::EntityAddComponent(const Entity& entityPointer)
 {
     AssertEntityPointerValid(entityPointer);
-#if defined(_DEBUG)
-    AssertComponentRegistered(C::ComponentName);
-#endif
+    const auto typeId = GetRegisteredTypeId<C>();
     if (EntityHasComponent<C>(entityPointer))
     {
         throw std::logic_error(std::string{ "Entity::AddComponent: Component " } + C::ComponentName + std::string{ " already exists" });
     }
-    auto component = std::make_unique<C>();
-    auto componentPtr = component.get();
-    mEntityComponents[entityPointer.mIndex].emplace_back(std::move(component));
+    auto componentPtr = static_cast<C*>(EntityAddStoredComponent(entityPointer, mComponentInfos[typeId]));
     EntityConstructComponent(componentPtr, entityPointer);
     return componentPtr;
-
 }
 
 template<typename C>
 void EntityManager::EntityRemoveComponent(const Entity& entityPointer)
 {
     AssertEntityPointerValid(entityPointer);
+    const auto typeId = Component::TypeId<C>();
 #if defined(_DEBUG)
-    AssertComponentRegistered(C::ComponentName);
+    if (!IsComponentRegistered(typeId))
+    {
+        AssertComponentRegistered(C::ComponentName);
+    }
 #endif
-    auto& components = mEntityComponents[entityPointer.mIndex];
     if (!EntityHasComponent<C>(entityPointer))
     {
         throw std::logic_error(std::string{ "Entity::RemoveComponent: Component " } + C::ComponentName + std::string{ " not found" });
     }
-    auto found = std::find_if(components.begin(), components.end(), [](const auto& c)
-    {
-        return C::ComponentName == c->GetComponentName();
-    });
-    if (found != components.end())
+    EntityRemoveStoredComponent(entityPointer, typeId);
+}
+
+template<typename F>
+void EntityManager::EntityForEachComponent(Entity::PointerSize index, F&& f) const
+{
+    EntityForEachComponent(index, mSignatures[index], std::forward<F>(f));
+}
+
+template<typename F>
+void EntityManager::EntityForEachComponent(Entity::PointerSize index, const ComponentMask& componentMask, F&& f) const
+{
+    for (ComponentTypeId typeId = 0; typeId < mComponentInfos.size(); typeId++)
     {
-        components.erase(found);
+        if (!componentMask[typeId])
+        {
+            continue;
+        }
+        f(mComponentInfos[typeId], GetStoredComponent(index, typeId));
     }
 }
 
@@ -401,36 +997,33 @@ template<typename C>
 bool EntityManager::EntityHasComponent(const Entity& entityPointer) const
 {
     AssertEntityPointerValid(entityPointer);
-    return EntityGetComponent<C>(entityPointer) != nullptr;
+    return mSignatures[entityPointer.mIndex][Component::TypeId<C>()];
 }
 
 template<typename C1, typename C2, typename ...C>
 bool EntityManager::EntityHasComponent(const Entity& entityPointer) const
 {
     AssertEntityPointerValid(entityPointer);
-    return EntityHasComponent<C1>(entityPointer) && EntityHasComponent<C2, C...>(entityPointer);
+    const auto& componentMask = GetComponentMask<C1, C2, C...>();
+    return (mSignatures[entityPointer.mIndex] & componentMask) == componentMask;
 }
 
 template<typename C>
 bool EntityManager::EntityHasAnyComponent(const Entity& entityPointer) const
 {
     AssertEntityPointerValid(entityPointer);
-    return EntityGetComponent<C>(entityPointer) != nullptr;
+    return mSignatures[entityPointer.mIndex][Component::TypeId<C>()];
 }
 
 template<typename C1, typename C2, typename ...C>
 bool EntityManager::EntityHasAnyComponent(const Entity& entityPointer) const
 {
     AssertEntityPointerValid(entityPointer);
-    if (EntityHasComponent<C1>(entityPointer))
-    {
-        return true;
-    }
-    return EntityHasComponent<C2, C...>(entityPointer);
+    return (mSignatures[entityPointer.mIndex] & GetComponentMask<C1, C2, C...>()).any();
 }
 
-template<typename... C>
-bool EntityManager::EntityAny(const Entity& entityPointer, typename std::common_type<std::function<void(C* ...)>>::type view)
+template<typename... C, typename F>
+bool EntityManager::EntityAny(const Entity& entityPointer, F&& view)
 {
     AssertEntityPointerValid(entityPointer);
     if (EntityHasAnyComponent<C...>(entityPointer))
@@ -441,8 +1034,8 @@ bool EntityManager::EntityAny(const Entity& entityPointer, typename std::common_
     return false;
 }
 
-template<typename... C>
-bool EntityManager::EntityWith(const Entity& entityPointer, typename std::common_type<std::function<void(C* ...)>>::type view)
+template<typename... C, typename F>
+bool EntityManager::EntityWith(const Entity& entityPointer, F&& view)
 {
     AssertEntityPointerValid(entityPointer);
     if (EntityHasComponent<C...>(entityPointer))
@@ -453,12 +1046,13 @@ bool EntityManager::EntityWith(const Entity& entityPointer, typename std::common
     return false;
 }
 
-template<typename... C>
-void EntityManager::Any(typename std::common_type<std::function<void(Entity, C* ...)>>::type view)
+template<typename... C, typename F>
+void EntityManager::Any(F&& view)
 {
+    const auto& componentMask = GetComponentMask<C...>();
     for (auto entityPointer : *this)
     {
-        if (entityPointer.HasAnyComponent<C...>())
+        if ((mSignatures[entityPointer.mIndex] & componentMask).any())
         {
             view(entityPointer, entityPointer.GetComponent<C>()...);
         }
@@ -469,9 +1063,10 @@ template<typename... C>
 std::vector<Entity> EntityManager::Any()
 {
     std::vector<Entity> entityPointers;
+    const auto& componentMask = GetComponentMask<C...>();
     for (auto entityPointer : *this)
     {
-        if (entityPointer.HasAnyComponent<C...>())
+        if ((mSignatures[entityPointer.mIndex] & componentMask).any())
         {
             entityPointers.emplace_back(entityPointer);
         }
@@ -479,28 +1074,185 @@ std::vector<Entity> EntityManager::Any()
     return entityPointers;
 }
 
-template<typename... C>
-void EntityManager::With(typename std::common_type<std::function<void(Entity, C* ...)>>::type view)
+template<typename... C, typename F>
+void EntityManager::With(F&& view)
 {
-    for (auto entityPointer : *this)
+    VisitWith<C...>([this, &view](Entity entityPointer, C* ...components)
     {
-        if (entityPointer.HasComponent<C...>())
+        MarkComponentsChanged<C...>(entityPointer.mIndex);
+        view(entityPointer, components...);
+    });
+}
+
+template<typename... C, typename F>
+void EntityManager::VisitWith(F&& view)
+{
+    const auto& componentMask = GetComponentMask<C...>();
+    RequireComponents(componentMask);
+    const auto archetypeMask = componentMask & mArchetypeComponents;
+    const auto sparseSetMask = componentMask & mSparseSetComponents;
+    if (archetypeMask.none() && sparseSetMask.any())
+    {
+        // only the entities of the smallest sparse set can match
+        const ComponentSparseSet* smallestSparseSet = nullptr;
+        for (auto typeId : { Component::TypeId<C>()... })
         {
-            view(entityPointer, entityPointer.GetComponent<C>()...);
+            if (sparseSetMask[typeId] && (smallestSparseSet == nullptr || mSparseSets[typeId]->Size() < smallestSparseSet->Size()))
+            {
+                smallestSparseSet = mSparseSets[typeId].get();
+            }
+        }
+        SparseSetWith<C...>(*smallestSparseSet, componentMask, view, std::index_sequence_for<C...>{});
+        return;
+    }
+    if (archetypeMask.none())
+    {
+        for (auto entityPointer : *this)
+        {
+            if ((mSignatures[entityPointer.mIndex] & componentMask) == componentMask)
+            {
+                view(entityPointer, GetStoredComponent<C>(entityPointer.mIndex)...);
+            }
+        }
+        return;
+    }
+    // when at least one component is stored in archetypes, only the archetypes holding all of those can match
+    const auto otherMask = componentMask & ~mArchetypeComponents;
+    for (const auto& archetype : mArchetypes)
+    {
+        if (archetype->Size() > 0 && (archetype->GetComponentMask() & archetypeMask) == archetypeMask)
+        {
+            ArchetypeWith<C...>(*archetype, otherMask, view, std::index_sequence_for<C...>{});
+        }
+    }
+}
+
+template<typename ...C, typename F, std::size_t ...I>
+void EntityManager::ArchetypeWith(const Archetype& archetype, const ComponentMask& componentMask, F& view, std::index_sequence<I...>)
+{
+    const std::array<std::ptrdiff_t, sizeof...(C)> columns{ { archetype.FindColumn(Component::TypeId<C>())... } };
+    for (std::size_t chunk = 0; chunk < archetype.GetChunkCount(); chunk++)
+    {
+        const auto entities = archetype.GetChunkEntities(chunk);
+        const std::array<unsigned char*, sizeof...(C)> bases{ { columns[I] < 0 ? nullptr : archetype.GetChunkColumn(chunk, static_cast<std::size_t>(columns[I]))... } };
+        for (std::size_t row = 0; row < archetype.GetChunkSize(chunk); row++)
+        {
+            const auto index = entities[row];
+            if ((mSignatures[index] & componentMask) == componentMask)
+            {
+                Entity entityPointer{ this, index, mVersions[index] };
+                view(entityPointer, (bases[I] != nullptr ? reinterpret_cast<C*>(bases[I] + row * sizeof(C)) : GetStoredComponent<C>(index))...);
+            }
+        }
+    }
+}
+
+template<typename ...C, typename F, std::size_t ...I>
+void EntityManager::SparseSetWith(const ComponentSparseSet& sparseSet, const ComponentMask& componentMask, F& view, std::index_sequence<I...>)
+{
+    const auto typeId = sparseSet.GetComponentInfo().mTypeId;
+    const auto entities = sparseSet.GetEntities();
+    const auto components = sparseSet.GetComponents();
+    for (std::size_t position = 0; position < sparseSet.Size(); position++)
+    {
+        const auto index = entities[position];
+        if ((mSignatures[index] & componentMask) == componentMask)
+        {
+            Entity entityPointer{ this, index, mVersions[index] };
+            view(entityPointer, (Component::TypeId<C>() == typeId ? reinterpret_cast<C*>(components + position * sizeof(C)) : GetStoredComponent<C>(index))...);
         }
     }
 }
 
 template<typename... C>
-std::vector<Entity> EntityManager::With()
+EntityManager::EntityView<C...> EntityManager::View()
 {
-    std::vector<Entity> entityPointers;
-    for (auto entityPointer : *this)
+    return EntityView<C...>(*this);
+}
+
+template<typename... C>
+EntityManager::QueryView<C...> EntityManager::Query()
+{
+    return QueryView<C...>(*this, GetOrCreateQuery(GetComponentMask<C...>()));
+}
+
+template<typename C>
+std::size_t EntityManager::ComponentCapacity() const
+{
+    return GetComponentCapacity(Component::TypeId<C>());
+}
+
+template<typename ...C>
+void EntityManager::Reserve(std::size_t entityCount, const std::array<std::size_t, sizeof...(C)>& componentCounts)
+{
+    Reserve(entityCount);
+    const std::array<ComponentTypeId, sizeof...(C)> typeIds{ { GetRegisteredTypeId<C>()... } };
+    for (std::size_t i = 0; i < typeIds.size(); i++)
     {
-        if (entityPointer.HasComponent<C...>())
+        ReserveComponents(typeIds[i], componentCounts[i]);
+    }
+}
+
+template<typename... C, typename F>
+void EntityManager::ParallelWith(F&& view)
+{
+    GetJobSystem().Wait(ScheduleWith<C...>(std::forward<F>(view)));
+}
+
+template<typename... C, typename F>
+JobHandle EntityManager::ScheduleWith(F&& view)
+{
+    static constexpr std::size_t GrainSize = 1024;
+    const auto& componentMask = GetComponentMask<C...>();
+    // views may read any component from any thread, nothing may be left to build lazily
+    RequireComponents(~ComponentMask{});
+    const auto sparseSetMask = componentMask & mSparseSetComponents;
+    if ((componentMask & mArchetypeComponents).none() && sparseSetMask.any())
+    {
+        // only the entities of the smallest sparse set can match, its dense entity array is split instead
+        const ComponentSparseSet* smallestSparseSet = nullptr;
+        for (auto typeId : { Component::TypeId<C>()... })
         {
-            entityPointers.emplace_back(entityPointer);
+            if (sparseSetMask[typeId] && (smallestSparseSet == nullptr || mSparseSets[typeId]->Size() < smallestSparseSet->Size()))
+            {
+                smallestSparseSet = mSparseSets[typeId].get();
+            }
         }
+        const auto entities = smallestSparseSet->GetEntities();
+        return GetJobSystem().ScheduleParallelFor(smallestSparseSet->Size(), GrainSize, [this, entities, &componentMask, view = std::forward<F>(view)](std::size_t begin, std::size_t end)
+        {
+            for (auto position = begin; position < end; position++)
+            {
+                const auto index = entities[position];
+                if ((mSignatures[index] & componentMask) == componentMask)
+                {
+                    MarkComponentsChanged<C...>(index);
+                    view(Entity(this, index, mVersions[index]), GetStoredComponent<C>(index)...);
+                }
+            }
+        });
     }
+    return GetJobSystem().ScheduleParallelFor(mVersions.size(), GrainSize, [this, &componentMask, view = std::forward<F>(view)](std::size_t begin, std::size_t end)
+    {
+        for (auto index = FindAliveIndex(begin); index < end; index = FindAliveIndex(index + 1))
+        {
+            if ((mSignatures[index] & componentMask) == componentMask)
+            {
+                const auto entityIndex = static_cast<Entity::PointerSize>(index);
+                MarkComponentsChanged<C...>(entityIndex);
+                view(Entity(this, entityIndex, mVersions[entityIndex]), GetStoredComponent<C>(entityIndex)...);
+            }
+        }
+    });
+}
+
+template<typename... C>
+std::vector<Entity> EntityManager::With()
+{
+    std::vector<Entity> entityPointers;
+    VisitWith<C...>([&entityPointers](Entity entityPointer, C* ...)
+    {
+        entityPointers.emplace_back(entityPointer);
+    });
     return entityPointers;
 }
\ No newline at end of file
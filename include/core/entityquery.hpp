@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "entity.hpp"
+#include "component.hpp"
+
+class EntityQuery final
+{
+public:
+    explicit EntityQuery(const ComponentMask& componentMask);
+
+public:
+    EntityQuery(const EntityQuery&) = delete;
+    EntityQuery& operator=(const EntityQuery&) = delete;
+
+public:
+    const ComponentMask& GetComponentMask() const;
+    std::size_t Size() const;
+    const Entity::PointerSize* GetEntities() const;
+    bool Contains(Entity::PointerSize index) const;
+    std::size_t GetByteSize() const;
+
+public:
+    void Update(Entity::PointerSize index, const ComponentMask& signature);
+    void Remove(Entity::PointerSize index);
+    void Clear();
+    void ShrinkToFit(std::size_t entityCount);
+
+private:
+    void Add(Entity::PointerSize index);
+
+private:
+    static constexpr std::uint32_t InvalidPosition = ~std::uint32_t{ 0 };
+
+private:
+    ComponentMask mComponentMask;
+    std::vector<Entity::PointerSize> mEntities;
+    std::vector<std::uint32_t> mPositions;
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+class JobSystem;
+struct JobContinuation;
+
+class JobHandle final
+{
+public:
+    friend JobSystem;
+
+public:
+    JobHandle() = default;
+
+public:
+    // a default constructed handle is always done
+    bool IsDone() const;
+
+private:
+    struct State
+    {
+        std::atomic<std::size_t> mPendingJobs{ 0 };
+        std::atomic<bool> mFailed{ false };
+        std::exception_ptr mException;
+        std::mutex mMutex;
+        std::vector<std::shared_ptr<JobContinuation>> mContinuations; // jobs waiting for this handle
+    };
+
+private:
+    std::shared_ptr<State> mState;
+};
+
+// each thread owns a job queue it pushes to and pops from the back, idle threads steal from the front of the others
+class JobSystem final
+{
+public:
+    explicit JobSystem(std::size_t threadCount);
+    // runs the jobs still queued on the calling thread, every handle it returned is done afterwards
+    ~JobSystem();
+
+public:
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+public:
+    // counts the calling thread, which runs jobs while it waits
+    std::size_t GetThreadCount() const;
+
+public:
+    JobHandle Schedule(std::function<void()> job);
+    // the job is queued once every dependency is done, whether or not they threw
+    JobHandle Schedule(std::function<void()> job, const std::vector<JobHandle>& dependencies);
+    // splits [0, count) in halves until ranges are at most grainSize long so idle threads can steal the upper halves
+    JobHandle ScheduleParallelFor(std::size_t count, std::size_t grainSize, std::function<void(std::size_t begin, std::size_t end)> job);
+    // runs other jobs until the handle is done, then rethrows the first exception thrown by its jobs
+    void Wait(const JobHandle& handle);
+    void ParallelFor(std::size_t count, std::size_t grainSize, std::function<void(std::size_t begin, std::size_t end)> job);
+
+private:
+    friend JobContinuation;
+
+    struct Job
+    {
+        std::function<void()> mFunction;
+        std::shared_ptr<JobHandle::State> mState;
+    };
+
+    struct JobQueue
+    {
+        std::mutex mMutex;
+        std::deque<Job> mJobs;
+    };
+
+private:
+    void Push(Job job);
+    void Complete(JobHandle::State& state);
+    bool TryRun();
+    bool TryPop(std::size_t queue, bool steal, Job& job);
+    std::size_t GetQueueIndex() const;
+    void WorkerLoop(std::size_t queue);
+    void SplitRange(const std::shared_ptr<JobHandle::State>& state, std::shared_ptr<std::function<void(std::size_t, std::size_t)>> job, std::size_t begin, std::size_t end, std::size_t grainSize);
+
+private:
+    std::vector<std::unique_ptr<JobQueue>> mQueues; // [0] is shared by every thread outside the system
+    std::vector<std::thread> mThreads;
+    std::atomic<std::size_t> mQueuedJobs{ 0 };
+    std::mutex mSleepMutex;
+    std::condition_variable mWakeUp;
+    bool mStopping = false;
+};
+
+struct JobContinuation
+{
+    JobSystem::Job mJob;
+    std::atomic<std::size_t> mDependencies{ 0 };
+};
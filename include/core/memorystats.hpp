@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "entity.hpp"
+#include "component.hpp"
+#include "componentinfo.hpp"
+
+// byte sizes count what is allocated, used byte sizes only what live components occupy
+struct ComponentMemoryStats final
+{
+    std::string mName;
+    ComponentTypeId mTypeId = 0;
+    ComponentStorage mStorage = ComponentStorage::eHeap;
+    std::size_t mCount = 0;
+    std::size_t mCapacity = 0;
+    std::size_t mUsedByteSize = 0;
+    std::size_t mByteSize = 0; // archetype components only count their columns, the chunks are counted in MemoryStats::mArchetypeByteSize
+};
+
+struct MemoryStats final
+{
+    std::vector<ComponentMemoryStats> mComponents; // registered component types in type id order
+    std::size_t mEntityCount = 0;
+    std::size_t mEntitySlotCount = 0;
+    std::size_t mEntityByteSize = 0; // versions, signatures, locations and alive bits of every slot
+    std::size_t mFreeIndexCount = 0;
+    std::size_t mFreeIndexByteSize = 0;
+    std::size_t mArchetypeCount = 0;
+    std::size_t mArchetypeByteSize = 0;
+    std::size_t mQueryCount = 0;
+    std::size_t mQueryByteSize = 0;
+    std::size_t mSystemCount = 0;
+    std::size_t mSystemByteSize = 0;
+    std::size_t mChangeSetByteSize = 0; // changed flags of every slot, one set per component type and one for the slots themselves
+
+    // every byte above except the archetype component columns which are already part of the archetype chunks
+    std::size_t GetByteSize() const;
+    std::size_t GetComponentByteSize() const;
+    std::size_t GetComponentUsedByteSize() const;
+    // share of the component storage allocated but not used by a live component, from 0 to 1
+    float GetFragmentation() const;
+};
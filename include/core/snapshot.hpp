@@ -0,0 +1,126 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <cstddef>
+#include <cstdint>
+
+#include "entity.hpp"
+#include "componentinfo.hpp"
+
+// components of one type read from a snapshot and not built yet, the payload is owned by the reader it came from
+struct SnapshotBlock final
+{
+    bool mData = false;
+    std::vector<Entity::PointerSize> mIndexes;
+    const char* mPayload = nullptr;
+    std::size_t mPayloadByteSize = 0;
+};
+
+// copies of components of one type taken so their Serialize can run on another thread, destroyed with the copies
+class ComponentCopies final
+{
+public:
+    ComponentCopies(const ComponentInfo& componentInfo, std::size_t capacity);
+    ~ComponentCopies();
+
+public:
+    ComponentCopies(const ComponentCopies&) = delete;
+    ComponentCopies& operator=(const ComponentCopies&) = delete;
+
+public:
+    void Add(const Component* component);
+    std::size_t Size() const;
+    Component* Get(std::size_t position) const;
+
+private:
+    ComponentInfo mComponentInfo;
+    std::unique_ptr<unsigned char[]> mData;
+    std::vector<Component*> mComponents;
+};
+
+// everything a snapshot holds, copied out of the world so it can be written without touching the world again
+struct SnapshotImage final
+{
+    struct ComponentBlock final
+    {
+        std::string mName;
+        std::uint32_t mDataSize = 0; // 0 when the payload holds what Serialize wrote
+        std::vector<Entity::PointerSize> mIndexes;
+        std::string mPayload;
+        std::unique_ptr<ComponentCopies> mCopies; // set while the payload is still to be serialized from them
+    };
+
+    std::vector<Entity::PointerSize> mVersions;
+    std::vector<std::uint64_t> mAliveEntities;
+    std::vector<Entity::PointerSize> mFreeIndexes;
+    std::vector<ComponentBlock> mComponents;
+};
+
+class SnapshotReader
+{
+public:
+    virtual ~SnapshotReader() = default;
+
+public:
+    virtual void Read(void* data, std::size_t byteSize) = 0;
+    // returns byteSize bytes that stay valid as long as the reader
+    virtual const char* ReadBlock(std::size_t byteSize) = 0;
+};
+
+class SnapshotStreamReader final : public SnapshotReader
+{
+public:
+    explicit SnapshotStreamReader(std::istream& is);
+
+public:
+    void Read(void* data, std::size_t byteSize) override;
+    const char* ReadBlock(std::size_t byteSize) override;
+
+private:
+    std::istream& mStream;
+    std::vector<std::vector<char>> mBlocks;
+};
+
+// reads bytes it owns, such as a decompressed snapshot
+class SnapshotBuffer final : public SnapshotReader
+{
+public:
+    SnapshotBuffer(std::unique_ptr<char[]> data, std::size_t byteSize);
+
+public:
+    void Read(void* data, std::size_t byteSize) override;
+    const char* ReadBlock(std::size_t byteSize) override;
+
+private:
+    std::unique_ptr<char[]> mData;
+    std::size_t mByteSize = 0;
+    std::size_t mOffset = 0;
+};
+
+// maps the whole file read-only and private, files are read whole where mmap is not available
+class SnapshotFile final : public SnapshotReader
+{
+public:
+    explicit SnapshotFile(const std::string& path);
+    ~SnapshotFile() override;
+
+public:
+    SnapshotFile(const SnapshotFile&) = delete;
+    SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+public:
+    std::size_t GetByteSize() const;
+
+public:
+    void Read(void* data, std::size_t byteSize) override;
+    const char* ReadBlock(std::size_t byteSize) override;
+
+private:
+    const char* mData = nullptr;
+    std::size_t mByteSize = 0;
+    std::size_t mOffset = 0;
+    std::unique_ptr<char[]> mBuffer;
+};
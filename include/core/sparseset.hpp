@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "entity.hpp"
+#include "componentinfo.hpp"
+
+class ComponentSparseSet final
+{
+public:
+    explicit ComponentSparseSet(ComponentInfo componentInfo);
+    ~ComponentSparseSet();
+
+public:
+    ComponentSparseSet(const ComponentSparseSet&) = delete;
+    ComponentSparseSet& operator=(const ComponentSparseSet&) = delete;
+
+public:
+    const ComponentInfo& GetComponentInfo() const;
+    std::size_t Size() const;
+    std::size_t GetCapacity() const;
+    std::size_t GetByteSize() const;
+    const Entity::PointerSize* GetEntities() const;
+    unsigned char* GetComponents() const;
+
+public:
+    void* Add(Entity::PointerSize index);
+    void Remove(Entity::PointerSize index);
+    void* Get(Entity::PointerSize index) const;
+    void Clear();
+    void Reserve(std::size_t capacity);
+    // fits the dense arrays to the components left and the sparse array to the given entity count
+    void ShrinkToFit(std::size_t entityCount);
+
+private:
+    void Grow(std::size_t capacity);
+
+private:
+    static constexpr std::uint32_t InvalidPosition = ~std::uint32_t{ 0 };
+
+private:
+    ComponentInfo mComponentInfo;
+    std::size_t mSize = 0;
+    std::size_t mCapacity = 0;
+    std::unique_ptr<unsigned char[]> mComponents;
+    std::vector<Entity::PointerSize> mEntities;
+    std::vector<std::uint32_t> mPositions;
+};
@@ -1,6 +1,11 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstddef>
+
+#include "entity.hpp"
+#include "component.hpp"
 
 #define DECLARE_SYSTEM(NAME) static constexpr const char* SystemName{#NAME}; virtual std::string GetSystemName() const override
 #define DEFINE_SYSTEM(NAME) std::string NAME::GetSystemName() const { return NAME::SystemName; } constexpr const char* NAME::SystemName
@@ -10,6 +15,28 @@
 
 class EntityManager;
 
+using SystemTypeId = std::size_t;
+
+// inherit alongside System to declare the components OnUpdate reads
+template<typename ...C>
+struct Reads
+{
+    static ComponentMask ReadComponents()
+    {
+        return Component::Mask<C...>();
+    }
+};
+
+// inherit alongside System to declare the components OnUpdate writes
+template<typename ...C>
+struct Writes
+{
+    static ComponentMask WriteComponents()
+    {
+        return Component::Mask<C...>();
+    }
+};
+
 class System
 {
 public:
@@ -21,12 +48,41 @@ public:
 public:
     virtual ~System() = 0;
 
+public:
+    template<typename S>
+    static SystemTypeId TypeId();
+
+private:
+    static SystemTypeId NextTypeId();
+
+public:
+    const ComponentMask& GetReadComponents() const;
+    const ComponentMask& GetWriteComponents() const;
+
 protected:
     virtual void OnLoad();
     virtual void OnResolveDependencies();
+    virtual void OnUpdate(float dt);
+
+protected:
+    // meant to be called from OnResolveDependencies, EntityManager::Update never runs both systems at once
+    void UpdateAfter(const System* system);
 
 protected:
     EntityManager* mManager = nullptr;
+
+private:
+    ComponentMask mReadComponents;
+    ComponentMask mWriteComponents;
+    std::vector<const System*> mUpdateAfter;
+    std::size_t mByteSize = 0;
 };
 
-#undef DECLARE_ROOT_SYSTEM
\ No newline at end of file
+template<typename S>
+SystemTypeId System::TypeId()
+{
+    static const auto typeId = NextTypeId();
+    return typeId;
+}
+
+#undef DECLARE_ROOT_SYSTEM
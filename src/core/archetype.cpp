@@ -0,0 +1,178 @@
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/archetype.hpp"
+
+namespace
+{
+    std::size_t AlignOffset(std::size_t offset, std::size_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    // Lays out one contiguous array per column (entity indexes first) for the given row capacity, returns the bytes needed
+    std::size_t LayoutColumns(const std::vector<ComponentInfo>& infos, std::size_t capacity, std::vector<std::size_t>& offsets)
+    {
+        auto offset = AlignOffset(sizeof(Entity::PointerSize) * capacity, alignof(std::max_align_t));
+        offsets.clear();
+        for (const auto& info : infos)
+        {
+            offset = AlignOffset(offset, info.mAlignment);
+            offsets.emplace_back(offset);
+            offset += info.mSize * capacity;
+        }
+        return offset;
+    }
+}
+
+ArchetypeChunk::ArchetypeChunk(std::size_t byteSize) : mData(new unsigned char[byteSize])
+{
+
+}
+
+Archetype::Archetype(const ComponentMask& componentMask, std::vector<ComponentInfo> componentInfos) : mComponentMask(componentMask), mComponentInfos(std::move(componentInfos))
+{
+    std::size_t rowSize = sizeof(Entity::PointerSize);
+    for (const auto& info : mComponentInfos)
+    {
+        if (info.mAlignment > alignof(std::max_align_t))
+        {
+            throw std::logic_error(std::string{ "Archetype: Component " } + info.mName + std::string{ " is over-aligned" });
+        }
+        if (info.mTypeId >= mColumns.size())
+        {
+            mColumns.resize(info.mTypeId + 1, -1);
+        }
+        mColumns[info.mTypeId] = &info - mComponentInfos.data();
+        rowSize += info.mSize;
+    }
+    mChunkCapacity = std::max<std::size_t>(1, mChunkByteSize / rowSize);
+    while (mChunkCapacity > 1 && LayoutColumns(mComponentInfos, mChunkCapacity, mColumnOffsets) > mChunkByteSize)
+    {
+        mChunkCapacity -= 1;
+    }
+    mChunkByteSize = std::max(mChunkByteSize, LayoutColumns(mComponentInfos, mChunkCapacity, mColumnOffsets));
+}
+
+Archetype::~Archetype()
+{
+    Clear();
+}
+
+const ComponentMask& Archetype::GetComponentMask() const
+{
+    return mComponentMask;
+}
+
+std::size_t Archetype::GetColumnCount() const
+{
+    return mComponentInfos.size();
+}
+
+const ComponentInfo& Archetype::GetComponentInfo(std::size_t column) const
+{
+    return mComponentInfos[column];
+}
+
+std::ptrdiff_t Archetype::FindColumn(ComponentTypeId typeId) const
+{
+    return typeId < mColumns.size() ? mColumns[typeId] : -1;
+}
+
+std::size_t Archetype::Size() const
+{
+    return mSize;
+}
+
+std::size_t Archetype::GetChunkCount() const
+{
+    return mChunks.size();
+}
+
+std::size_t Archetype::GetChunkSize(std::size_t chunk) const
+{
+    return mChunks[chunk]->mCount;
+}
+
+std::size_t Archetype::GetChunkCapacity() const
+{
+    return mChunkCapacity;
+}
+
+std::size_t Archetype::GetByteSize() const
+{
+    return mChunks.size() * mChunkByteSize;
+}
+
+Entity::PointerSize* Archetype::GetChunkEntities(std::size_t chunk) const
+{
+    return reinterpret_cast<Entity::PointerSize*>(mChunks[chunk]->mData.get());
+}
+
+unsigned char* Archetype::GetChunkColumn(std::size_t chunk, std::size_t column) const
+{
+    return mChunks[chunk]->mData.get() + mColumnOffsets[column];
+}
+
+std::size_t Archetype::AddRow(Entity::PointerSize entityIndex)
+{
+    auto row = mSize;
+    auto chunk = row / mChunkCapacity;
+    if (chunk == mChunks.size())
+    {
+        mChunks.emplace_back(std::make_unique<ArchetypeChunk>(mChunkByteSize));
+    }
+    GetChunkEntities(chunk)[row % mChunkCapacity] = entityIndex;
+    mChunks[chunk]->mCount += 1;
+    mSize += 1;
+    return row;
+}
+
+bool Archetype::RemoveRow(std::size_t row, Entity::PointerSize& movedEntityIndex)
+{
+    auto last = mSize - 1;
+    auto moved = false;
+    if (row != last)
+    {
+        for (std::size_t column = 0; column < mComponentInfos.size(); column++)
+        {
+            mComponentInfos[column].mRelocate(GetComponent(row, column), GetComponent(last, column));
+        }
+        movedEntityIndex = GetEntityIndex(last);
+        GetChunkEntities(row / mChunkCapacity)[row % mChunkCapacity] = movedEntityIndex;
+        moved = true;
+    }
+    mChunks[last / mChunkCapacity]->mCount -= 1;
+    mSize -= 1;
+    return moved;
+}
+
+void* Archetype::GetComponent(std::size_t row, std::size_t column) const
+{
+    return GetChunkColumn(row / mChunkCapacity, column) + (row % mChunkCapacity) * mComponentInfos[column].mSize;
+}
+
+Entity::PointerSize Archetype::GetEntityIndex(std::size_t row) const
+{
+    return GetChunkEntities(row / mChunkCapacity)[row % mChunkCapacity];
+}
+
+void Archetype::ShrinkToFit()
+{
+    mChunks.resize((mSize + mChunkCapacity - 1) / mChunkCapacity);
+    mChunks.shrink_to_fit();
+}
+
+void Archetype::Clear()
+{
+    for (std::size_t row = 0; row < mSize; row++)
+    {
+        for (std::size_t column = 0; column < mComponentInfos.size(); column++)
+        {
+            mComponentInfos[column].mDestroy(GetComponent(row, column));
+        }
+    }
+    mSize = 0;
+    mChunks.clear();
+}
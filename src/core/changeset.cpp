@@ -0,0 +1,45 @@
+#include <algorithm>
+
+#include "core/changeset.hpp"
+
+std::size_t ChangeSet::Size() const
+{
+    return mSize;
+}
+
+std::size_t ChangeSet::GetByteSize() const
+{
+    return mCapacity * sizeof(std::atomic<std::uint8_t>);
+}
+
+void ChangeSet::Resize(std::size_t size)
+{
+    if (size <= mSize)
+    {
+        return;
+    }
+    if (size > mCapacity)
+    {
+        const auto capacity = std::max(size, mCapacity * 2);
+        std::unique_ptr<std::atomic<std::uint8_t>[]> flags(new std::atomic<std::uint8_t>[capacity]);
+        for (std::size_t index = 0; index < mSize; index++)
+        {
+            flags[index].store(mFlags[index].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        mFlags = std::move(flags);
+        mCapacity = capacity;
+    }
+    for (auto index = mSize; index < size; index++)
+    {
+        mFlags[index].store(0, std::memory_order_relaxed);
+    }
+    mSize = size;
+}
+
+void ChangeSet::Clear()
+{
+    for (std::size_t index = 0; index < mSize; index++)
+    {
+        mFlags[index].store(0, std::memory_order_relaxed);
+    }
+}
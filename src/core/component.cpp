@@ -1,3 +1,6 @@
+#include <atomic>
+#include <stdexcept>
+
 #include "core/entity.hpp"
 #include "core/component.hpp"
 
@@ -8,9 +11,20 @@ Component::~Component() // NOLINT
 
 }
 
+ComponentTypeId Component::NextTypeId()
+{
+    static std::atomic<ComponentTypeId> nextTypeId{ 0 };
+    auto typeId = nextTypeId++;
+    if (typeId >= ALIVE_ECS_MAX_COMPONENTS)
+    {
+        throw std::logic_error("Component::TypeId: Too many component types, raise ALIVE_ECS_MAX_COMPONENTS");
+    }
+    return typeId;
+}
+
 void Component::OnLoad()
 {
-    OnResolveDependencies();
+
 }
 
 void Component::OnResolveDependencies()
@@ -0,0 +1,196 @@
+#include <string>
+#include <utility>
+#include <iterator>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/componentpool.hpp"
+
+constexpr std::size_t ComponentPool::SlabByteSize;
+
+ComponentArena::ComponentArena(void* memory, std::size_t byteSize) : mMemory(static_cast<unsigned char*>(memory)), mByteSize(byteSize)
+{
+
+}
+
+void* ComponentArena::Allocate(std::size_t byteSize, std::size_t alignment)
+{
+    const auto address = reinterpret_cast<std::uintptr_t>(mMemory + mOffset);
+    const auto padding = (alignment - address % alignment) % alignment;
+    if (mOffset + padding + byteSize > mByteSize)
+    {
+        return nullptr;
+    }
+    auto memory = mMemory + mOffset + padding;
+    mOffset += padding + byteSize;
+    return memory;
+}
+
+std::size_t ComponentArena::GetByteSize() const
+{
+    return mByteSize;
+}
+
+std::size_t ComponentArena::GetUsedByteSize() const
+{
+    return mOffset;
+}
+
+ComponentPool::ComponentPool(const ComponentInfo& componentInfo)
+{
+    if (componentInfo.mAlignment > alignof(std::max_align_t))
+    {
+        throw std::logic_error(std::string{ "ComponentPool: Component " } + componentInfo.mName + std::string{ " is over-aligned" });
+    }
+    // every slot must be able to hold a free list link and keep the next slot aligned
+    const auto alignment = std::max(componentInfo.mAlignment, alignof(FreeSlot));
+    mSlotSize = (std::max(componentInfo.mSize, sizeof(FreeSlot)) + alignment - 1) / alignment * alignment;
+    mSlabSlots = std::max<std::size_t>(1, SlabByteSize / mSlotSize);
+}
+
+void ComponentPool::SetArena(ComponentArena* arena)
+{
+    mArena = arena;
+}
+
+std::size_t ComponentPool::Size() const
+{
+    return mSize;
+}
+
+std::size_t ComponentPool::GetCapacity() const
+{
+    return mSlabs.size() * mSlabSlots;
+}
+
+std::size_t ComponentPool::GetByteSize() const
+{
+    return mSlabs.size() * mSlabSlots * mSlotSize;
+}
+
+void* ComponentPool::Allocate()
+{
+    if (mFreeSlots == nullptr)
+    {
+        AddSlab();
+    }
+    auto slot = mFreeSlots;
+    mFreeSlots = slot->mNext;
+    mSize += 1;
+    return slot;
+}
+
+void ComponentPool::Free(void* slot)
+{
+    auto freeSlot = static_cast<FreeSlot*>(slot);
+    freeSlot->mNext = mFreeSlots;
+    mFreeSlots = freeSlot;
+    mSize -= 1;
+}
+
+void ComponentPool::Clear()
+{
+    // keeps the slabs around so the next burst of allocations does not reach the global heap
+    mFreeSlots = nullptr;
+    for (auto slab = mSlabs.rbegin(); slab != mSlabs.rend(); ++slab)
+    {
+        for (auto slot = mSlabSlots; slot-- > 0;)
+        {
+            auto freeSlot = reinterpret_cast<FreeSlot*>(*slab + slot * mSlotSize);
+            freeSlot->mNext = mFreeSlots;
+            mFreeSlots = freeSlot;
+        }
+    }
+    mSize = 0;
+}
+
+void ComponentPool::Reserve(std::size_t capacity)
+{
+    while (GetCapacity() < capacity)
+    {
+        AddSlab();
+    }
+}
+
+void ComponentPool::ShrinkToFit()
+{
+    // counts the free slots of every slab, slabs are looked up by address
+    std::vector<std::pair<unsigned char*, std::size_t>> slabsByAddress;
+    slabsByAddress.reserve(mSlabs.size());
+    for (std::size_t slab = 0; slab < mSlabs.size(); slab++)
+    {
+        slabsByAddress.emplace_back(mSlabs[slab], slab);
+    }
+    std::sort(slabsByAddress.begin(), slabsByAddress.end());
+    const auto findSlab = [&](FreeSlot* slot)
+    {
+        auto found = std::upper_bound(slabsByAddress.begin(), slabsByAddress.end(), std::make_pair(reinterpret_cast<unsigned char*>(slot), mSlabs.size()));
+        return std::prev(found)->second;
+    };
+    std::vector<std::size_t> freeSlots(mSlabs.size(), 0);
+    for (auto slot = mFreeSlots; slot != nullptr; slot = slot->mNext)
+    {
+        freeSlots[findSlab(slot)] += 1;
+    }
+
+    std::vector<bool> released(mSlabs.size(), false);
+    for (const auto& heapSlab : mHeapSlabs)
+    {
+        auto found = std::lower_bound(slabsByAddress.begin(), slabsByAddress.end(), std::make_pair(heapSlab.get(), std::size_t{ 0 }));
+        released[found->second] = freeSlots[found->second] == mSlabSlots;
+    }
+
+    // relinks the remaining free slots in their previous order
+    FreeSlot* freeSlotsHead = nullptr;
+    auto freeSlotsTail = &freeSlotsHead;
+    for (auto slot = mFreeSlots; slot != nullptr; slot = slot->mNext)
+    {
+        if (!released[findSlab(slot)])
+        {
+            *freeSlotsTail = slot;
+            freeSlotsTail = &slot->mNext;
+        }
+    }
+    *freeSlotsTail = nullptr;
+    mFreeSlots = freeSlotsHead;
+
+    for (auto& heapSlab : mHeapSlabs)
+    {
+        auto found = std::lower_bound(slabsByAddress.begin(), slabsByAddress.end(), std::make_pair(heapSlab.get(), std::size_t{ 0 }));
+        if (released[found->second])
+        {
+            heapSlab.reset();
+        }
+    }
+    mHeapSlabs.erase(std::remove(mHeapSlabs.begin(), mHeapSlabs.end(), nullptr), mHeapSlabs.end());
+
+    std::vector<unsigned char*> slabs;
+    slabs.reserve(mSlabs.size());
+    for (std::size_t slab = 0; slab < mSlabs.size(); slab++)
+    {
+        if (!released[slab])
+        {
+            slabs.emplace_back(mSlabs[slab]);
+        }
+    }
+    mSlabs = std::move(slabs);
+}
+
+void ComponentPool::AddSlab()
+{
+    const auto byteSize = mSlotSize * mSlabSlots;
+    auto slab = mArena != nullptr ? static_cast<unsigned char*>(mArena->Allocate(byteSize, alignof(std::max_align_t))) : nullptr;
+    if (slab == nullptr)
+    {
+        mHeapSlabs.emplace_back(new unsigned char[byteSize]);
+        slab = mHeapSlabs.back().get();
+    }
+    mSlabs.emplace_back(slab);
+    for (auto slot = mSlabSlots; slot-- > 0;)
+    {
+        auto freeSlot = reinterpret_cast<FreeSlot*>(slab + slot * mSlotSize);
+        freeSlot->mNext = mFreeSlots;
+        mFreeSlots = freeSlot;
+    }
+}
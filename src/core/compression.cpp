@@ -0,0 +1,325 @@
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/jobsystem.hpp"
+#include "core/compression.hpp"
+
+namespace
+{
+    const char CompressedMagic[4] = { 'A', 'E', 'C', 'Z' };
+    constexpr std::uint32_t CompressedVersion = 1;
+    constexpr std::size_t BlockByteSize = 128 * 1024;
+    constexpr std::uint32_t StoredBlock = 0x80000000u; // set in the size of a block kept uncompressed
+
+    constexpr std::size_t MinMatch = 4;
+    constexpr std::size_t MaxOffset = 65535;
+    constexpr unsigned HashBits = 14;
+
+    std::uint32_t Load32(const unsigned char* data)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    std::uint32_t Hash(std::uint32_t value)
+    {
+        return (value * 2654435761u) >> (32 - HashBits);
+    }
+
+    [[noreturn]] void ThrowCorruptedBlock()
+    {
+        throw std::logic_error("DecompressBlock: Corrupted block");
+    }
+
+    // lengths that do not fit in their token nibble continue in bytes of 255 ended by a smaller one
+    unsigned char* WriteLength(unsigned char* out, std::size_t length)
+    {
+        while (length >= 255)
+        {
+            *out++ = 255;
+            length -= 255;
+        }
+        *out++ = static_cast<unsigned char>(length);
+        return out;
+    }
+
+    std::size_t ReadLength(const unsigned char*& in, const unsigned char* end)
+    {
+        std::size_t length = 0;
+        unsigned char byte;
+        do
+        {
+            if (in == end)
+            {
+                ThrowCorruptedBlock();
+            }
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return length;
+    }
+
+    // a match length of 0 ends the block, only the literals are written
+    unsigned char* WriteSequence(unsigned char* out, const unsigned char* literals, std::size_t literalLength, std::size_t offset, std::size_t matchLength)
+    {
+        const auto matchCode = matchLength != 0 ? matchLength - MinMatch : 0;
+        *out++ = static_cast<unsigned char>((std::min<std::size_t>(literalLength, 15) << 4) | std::min<std::size_t>(matchCode, 15));
+        if (literalLength >= 15)
+        {
+            out = WriteLength(out, literalLength - 15);
+        }
+        std::memcpy(out, literals, literalLength);
+        out += literalLength;
+        if (matchLength != 0)
+        {
+            *out++ = static_cast<unsigned char>(offset & 0xffu);
+            *out++ = static_cast<unsigned char>(offset >> 8);
+            if (matchCode >= 15)
+            {
+                out = WriteLength(out, matchCode - 15);
+            }
+        }
+        return out;
+    }
+
+    template<typename T>
+    void WriteValue(std::ostream& os, const T& value)
+    {
+        os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    T ReadValue(SnapshotReader& reader)
+    {
+        T value;
+        reader.Read(&value, sizeof(T));
+        return value;
+    }
+
+    // grows values a chunk at a time, a corrupted count runs out of data before it is allocated
+    template<typename T>
+    void ReadValues(SnapshotReader& reader, std::vector<T>& values, std::size_t count)
+    {
+        static constexpr std::size_t ChunkByteSize = 64 * 1024;
+        values.clear();
+        while (values.size() < count)
+        {
+            const auto offset = values.size();
+            values.resize(offset + std::min(ChunkByteSize / sizeof(T), count - offset));
+            reader.Read(&values[offset], sizeof(T) * (values.size() - offset));
+        }
+    }
+}
+
+std::size_t GetCompressedBlockBound(std::size_t byteSize)
+{
+    return byteSize + byteSize / 255 + 16;
+}
+
+std::size_t CompressBlock(const char* source, std::size_t byteSize, char* destination)
+{
+    const auto begin = reinterpret_cast<const unsigned char*>(source);
+    const auto end = begin + byteSize;
+    auto out = reinterpret_cast<unsigned char*>(destination);
+    // last position seen for each hash, plus one so 0 means none
+    std::vector<std::uint32_t> positions(std::size_t{ 1 } << HashBits, 0);
+    auto anchor = begin;
+    auto position = begin;
+    std::size_t misses = 0;
+    while (byteSize >= MinMatch && position <= end - MinMatch)
+    {
+        const auto value = Load32(position);
+        auto& entry = positions[Hash(value)];
+        auto candidate = entry != 0 ? begin + entry - 1 : nullptr;
+        entry = static_cast<std::uint32_t>(position - begin + 1);
+        if (candidate == nullptr || static_cast<std::size_t>(position - candidate) > MaxOffset || Load32(candidate) != value)
+        {
+            // data that does not compress is skipped faster and faster
+            position += 1 + (misses++ >> 6);
+            continue;
+        }
+        misses = 0;
+        auto matchEnd = position + MinMatch;
+        auto from = candidate + MinMatch;
+        while (matchEnd < end && *matchEnd == *from)
+        {
+            ++matchEnd;
+            ++from;
+        }
+        while (position > anchor && candidate > begin && position[-1] == candidate[-1])
+        {
+            --position;
+            --candidate;
+        }
+        out = WriteSequence(out, anchor, static_cast<std::size_t>(position - anchor), static_cast<std::size_t>(position - candidate), static_cast<std::size_t>(matchEnd - position));
+        position = anchor = matchEnd;
+    }
+    out = WriteSequence(out, anchor, static_cast<std::size_t>(end - anchor), 0, 0);
+    return static_cast<std::size_t>(out - reinterpret_cast<unsigned char*>(destination));
+}
+
+void DecompressBlock(const char* source, std::size_t compressedByteSize, char* destination, std::size_t byteSize)
+{
+    auto in = reinterpret_cast<const unsigned char*>(source);
+    const auto inEnd = in + compressedByteSize;
+    const auto outBegin = reinterpret_cast<unsigned char*>(destination);
+    const auto outEnd = outBegin + byteSize;
+    auto out = outBegin;
+    while (true)
+    {
+        if (in == inEnd)
+        {
+            ThrowCorruptedBlock();
+        }
+        const auto token = *in++;
+        std::size_t literalLength = token >> 4;
+        if (literalLength == 15)
+        {
+            literalLength += ReadLength(in, inEnd);
+        }
+        if (literalLength > static_cast<std::size_t>(inEnd - in) || literalLength > static_cast<std::size_t>(outEnd - out))
+        {
+            ThrowCorruptedBlock();
+        }
+        std::memcpy(out, in, literalLength);
+        in += literalLength;
+        out += literalLength;
+        if (in == inEnd)
+        {
+            break;
+        }
+        if (inEnd - in < 2)
+        {
+            ThrowCorruptedBlock();
+        }
+        const auto offset = static_cast<std::size_t>(in[0]) | (static_cast<std::size_t>(in[1]) << 8);
+        in += 2;
+        std::size_t matchLength = token & 15u;
+        if (matchLength == 15)
+        {
+            matchLength += ReadLength(in, inEnd);
+        }
+        matchLength += MinMatch;
+        if (offset == 0 || offset > static_cast<std::size_t>(out - outBegin) || matchLength > static_cast<std::size_t>(outEnd - out))
+        {
+            ThrowCorruptedBlock();
+        }
+        // a match longer than its offset repeats the last offset bytes, each copy doubles what can be copied next
+        const auto from = out - offset;
+        const auto matchEnd = out + matchLength;
+        while (out < matchEnd)
+        {
+            const auto byteSize = std::min(static_cast<std::size_t>(out - from), static_cast<std::size_t>(matchEnd - out));
+            std::memcpy(out, from, byteSize);
+            out += byteSize;
+        }
+    }
+    if (out != outEnd)
+    {
+        ThrowCorruptedBlock();
+    }
+}
+
+bool IsCompressedSnapshot(const char* magic, std::size_t byteSize)
+{
+    return byteSize == sizeof(CompressedMagic) && std::equal(magic, magic + byteSize, CompressedMagic);
+}
+
+void WriteCompressedSnapshot(const std::string& snapshot, std::ostream& os)
+{
+    const auto blockCount = (snapshot.size() + BlockByteSize - 1) / BlockByteSize;
+    std::vector<std::uint32_t> blockSizes(blockCount);
+    std::string blocks;
+    std::unique_ptr<char[]> buffer(new char[GetCompressedBlockBound(BlockByteSize)]);
+    for (std::size_t block = 0; block < blockCount; block++)
+    {
+        const auto data = snapshot.data() + block * BlockByteSize;
+        const auto byteSize = std::min(BlockByteSize, snapshot.size() - block * BlockByteSize);
+        const auto compressedByteSize = CompressBlock(data, byteSize, buffer.get());
+        if (compressedByteSize < byteSize)
+        {
+            blockSizes[block] = static_cast<std::uint32_t>(compressedByteSize);
+            blocks.append(buffer.get(), compressedByteSize);
+        }
+        else
+        {
+            blockSizes[block] = static_cast<std::uint32_t>(byteSize) | StoredBlock;
+            blocks.append(data, byteSize);
+        }
+    }
+    os.write(CompressedMagic, sizeof(CompressedMagic));
+    WriteValue(os, CompressedVersion);
+    WriteValue(os, static_cast<std::uint32_t>(BlockByteSize));
+    WriteValue(os, static_cast<std::uint64_t>(snapshot.size()));
+    WriteValue(os, static_cast<std::uint64_t>(blockCount));
+    os.write(reinterpret_cast<const char*>(blockSizes.data()), static_cast<std::streamsize>(sizeof(std::uint32_t) * blockSizes.size()));
+    os.write(blocks.data(), static_cast<std::streamsize>(blocks.size()));
+}
+
+std::unique_ptr<SnapshotReader> ReadCompressedSnapshot(SnapshotReader& reader, JobSystem* jobSystem)
+{
+    if (ReadValue<std::uint32_t>(reader) != CompressedVersion)
+    {
+        throw std::logic_error("ReadCompressedSnapshot: Unsupported compressed snapshot version");
+    }
+    const auto blockByteSize = ReadValue<std::uint32_t>(reader);
+    const auto byteSize = ReadValue<std::uint64_t>(reader);
+    const auto blockCount = ReadValue<std::uint64_t>(reader);
+    if (blockByteSize == 0 || blockByteSize > BlockByteSize || blockCount != (byteSize + blockByteSize - 1) / blockByteSize)
+    {
+        throw std::logic_error("ReadCompressedSnapshot: Corrupted compressed snapshot");
+    }
+    std::vector<std::uint32_t> blockSizes;
+    ReadValues(reader, blockSizes, blockCount);
+    std::vector<std::size_t> blockOffsets(blockCount);
+    std::size_t compressedByteSize = 0;
+    for (std::size_t block = 0; block < blockCount; block++)
+    {
+        // a sequence byte covers at most 255 bytes, so byteSize stays within what was actually read
+        const auto blockSize = std::min<std::size_t>(blockByteSize, byteSize - block * blockByteSize);
+        if ((blockSizes[block] & ~StoredBlock) < blockSize / 255 + 1)
+        {
+            ThrowCorruptedBlock();
+        }
+        blockOffsets[block] = compressedByteSize;
+        compressedByteSize += blockSizes[block] & ~StoredBlock;
+    }
+    const auto compressed = reader.ReadBlock(compressedByteSize);
+
+    std::unique_ptr<char[]> data(new char[byteSize]);
+    const auto decompress = [&](std::size_t begin, std::size_t end)
+    {
+        for (auto block = begin; block < end; block++)
+        {
+            const auto source = compressed + blockOffsets[block];
+            const auto destination = data.get() + block * blockByteSize;
+            const auto blockSize = std::min<std::size_t>(blockByteSize, byteSize - block * blockByteSize);
+            if ((blockSizes[block] & StoredBlock) == 0)
+            {
+                DecompressBlock(source, blockSizes[block], destination, blockSize);
+            }
+            else if ((blockSizes[block] & ~StoredBlock) == blockSize)
+            {
+                std::memcpy(destination, source, blockSize);
+            }
+            else
+            {
+                ThrowCorruptedBlock();
+            }
+        }
+    };
+    if (jobSystem != nullptr)
+    {
+        jobSystem->ParallelFor(blockCount, 1, decompress);
+    }
+    else
+    {
+        decompress(0, blockCount);
+    }
+    return std::make_unique<SnapshotBuffer>(std::move(data), byteSize);
+}
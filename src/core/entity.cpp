@@ -6,6 +6,9 @@ Entity::Entity(EntityManager* manager) : mManager(manager)
 
 }
 
+constexpr Entity::PointerSize Entity::MaxIndex;
+constexpr Entity::PointerSize Entity::MaxVersion;
+
 Entity::Entity(EntityManager* manager, PointerSize index, PointerSize version) : mManager(manager), mIndex(index), mVersion(version)
 {
 
@@ -0,0 +1,121 @@
+#include <atomic>
+#include <utility>
+#include <algorithm>
+
+#include "core/entitycommandbuffer.hpp"
+
+namespace
+{
+    // every buffer gets its own serial so a thread cache never outlives the buffer it points into
+    std::atomic<std::uint64_t> gNextSerial{ 1 };
+
+    struct ThreadCommandCache
+    {
+        std::uint64_t mSerial = 0;
+        void* mCommands = nullptr;
+    };
+
+    thread_local ThreadCommandCache tCommandCache;
+}
+
+EntityCommandBuffer::EntityCommandBuffer(EntityManager& manager) : mManager(manager), mSerial(gNextSerial++)
+{
+
+}
+
+void EntityCommandBuffer::DestroyEntity(const Entity& entityPointer)
+{
+    Record(CommandType::eDestroy, entityPointer, nullptr);
+}
+
+void EntityCommandBuffer::Playback()
+{
+    std::vector<Command> commands;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& threadCommands : mThreadCommands)
+        {
+            std::move(threadCommands.second->begin(), threadCommands.second->end(), std::back_inserter(commands));
+            threadCommands.second->clear();
+        }
+    }
+    // creations go last, the other commands are grouped by entity index so each entity is touched once
+    std::stable_sort(commands.begin(), commands.end(), [](const Command& a, const Command& b)
+    {
+        if ((a.mType == CommandType::eCreate) != (b.mType == CommandType::eCreate))
+        {
+            return b.mType == CommandType::eCreate;
+        }
+        return a.mType != CommandType::eCreate && a.mEntity.mIndex < b.mEntity.mIndex;
+    });
+    for (auto& command : commands)
+    {
+        switch (command.mType)
+        {
+            case CommandType::eCreate:
+            {
+                auto entityPointer = mManager.CreateEntity();
+                command.mApply(entityPointer);
+                break;
+            }
+            case CommandType::eDestroy:
+                if (command.mEntity.IsValid())
+                {
+                    command.mEntity.Destroy();
+                }
+                break;
+            case CommandType::eApply:
+                if (command.mEntity.IsValid())
+                {
+                    command.mApply(command.mEntity);
+                }
+                break;
+        }
+    }
+}
+
+std::size_t EntityCommandBuffer::Size() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::size_t size = 0;
+    for (const auto& threadCommands : mThreadCommands)
+    {
+        size += threadCommands.second->size();
+    }
+    return size;
+}
+
+bool EntityCommandBuffer::IsEmpty() const
+{
+    return Size() == 0;
+}
+
+void EntityCommandBuffer::Clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& threadCommands : mThreadCommands)
+    {
+        threadCommands.second->clear();
+    }
+}
+
+EntityCommandBuffer::CommandList& EntityCommandBuffer::GetThreadCommands()
+{
+    if (tCommandCache.mSerial != mSerial)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& commands = mThreadCommands[std::this_thread::get_id()];
+        if (commands == nullptr)
+        {
+            commands = std::make_unique<CommandList>();
+        }
+        tCommandCache.mSerial = mSerial;
+        tCommandCache.mCommands = commands.get();
+    }
+    return *static_cast<CommandList*>(tCommandCache.mCommands);
+}
+
+void EntityCommandBuffer::Record(CommandType type, const Entity& entityPointer, std::function<void(Entity&)> apply)
+{
+    GetThreadCommands().push_back({ type, entityPointer, std::move(apply) });
+}
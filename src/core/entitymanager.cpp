@@ -1,166 +1,1513 @@
+#include <bitset>
 #include <cstring>
 #include <ostream>
 #include <istream>
 #include <sstream>
 #include <algorithm>
+#include <streambuf>
 
 #include "core/entitymanager.hpp"
 
+namespace
+{
+    const char SnapshotMagic[4] = { 'A', 'E', 'C', 'S' };
+    const char DeltaMagic[4] = { 'A', 'E', 'C', 'D' };
+    constexpr std::uint32_t SnapshotVersion = 1;
+
+    // eData blocks hold the raw SerializedData of each component, eStream blocks whatever Serialize wrote
+    enum class SnapshotEncoding : std::uint32_t
+    {
+        eData,
+        eStream,
+    };
+
+    template<typename T>
+    void WriteValue(std::ostream& os, const T& value)
+    {
+        os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    void WriteValues(std::ostream& os, const T* values, std::size_t count)
+    {
+        os.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(sizeof(T) * count));
+    }
+
+    template<typename T>
+    void ReadValues(SnapshotReader& reader, T* values, std::size_t count)
+    {
+        reader.Read(values, sizeof(T) * count);
+    }
+
+    template<typename T>
+    T ReadValue(SnapshotReader& reader)
+    {
+        T value;
+        ReadValues(reader, &value, 1);
+        return value;
+    }
+
+    // grows values as the bytes arrive, a corrupted count fails on the missing bytes instead of allocating them all
+    template<typename Container>
+    void ReadContainer(SnapshotReader& reader, Container& values, std::size_t count)
+    {
+        static constexpr std::size_t ChunkByteSize = 64 * 1024;
+        const auto chunkSize = std::max<std::size_t>(1, ChunkByteSize / sizeof(values[0]));
+        values.clear();
+        while (values.size() < count)
+        {
+            const auto offset = values.size();
+            values.resize(offset + std::min(chunkSize, count - offset));
+            ReadValues(reader, &values[offset], values.size() - offset);
+        }
+    }
+
+    // lets Deserialize read a block in place
+    class SnapshotStreamBuffer final : public std::streambuf
+    {
+    public:
+        SnapshotStreamBuffer(const char* data, std::size_t byteSize)
+        {
+            auto begin = const_cast<char*>(data);
+            setg(begin, begin, begin + byteSize);
+        }
+    };
+
+    bool SystemsConflict(const System& a, const System& b)
+    {
+        return (a.GetWriteComponents() & (b.GetReadComponents() | b.GetWriteComponents())).any() || (b.GetWriteComponents() & a.GetReadComponents()).any();
+    }
+}
+
+EntityManager::~EntityManager()
+{
+    ClearHeapComponents();
+}
+
 Entity EntityManager::CreateEntity()
 {
-    Entity::PointerSize index;
-    Entity::PointerSize version;
-    if (mFreeIndexes.empty())
+    Entity::PointerSize index;
+    Entity::PointerSize version;
+    if (mFreeIndexes.empty())
+    {
+        if (mNextIndex == Entity::MaxIndex)
+        {
+            throw std::logic_error("EntityManager::CreateEntity: Too many entities, raise ALIVE_ECS_ENTITY_POINTER_BITS");
+        }
+        index = mNextIndex++;
+        mVersions.resize(index + 1);
+        mSignatures.resize(index + 1);
+        mEntityLocations.resize(index + 1);
+        version = mVersions[index] = mFirstVersion;
+        ResizeChangeSets();
+    }
+    else
+    {
+        index = mFreeIndexes.back();
+        version = mVersions[index];
+        mFreeIndexes.pop_back();
+    }
+    SetEntityAlive(index, true);
+    mChangedEntities.Set(index);
+    UpdateQueries(index);
+    return { this, index, version };
+}
+
+void EntityManager::CreateEntities(std::size_t count, const ComponentTypeId* typeIds, std::size_t typeCount, std::vector<Entity>& entityPointers)
+{
+    const auto reused = std::min(count, mFreeIndexes.size());
+    const auto added = count - reused;
+    if (added > static_cast<std::size_t>(Entity::MaxIndex - mNextIndex))
+    {
+        throw std::logic_error("EntityManager::CreateEntitiesWith: Too many entities, raise ALIVE_ECS_ENTITY_POINTER_BITS");
+    }
+    ComponentMask componentMask;
+    for (std::size_t i = 0; i < typeCount; i++)
+    {
+        componentMask.set(typeIds[i]);
+    }
+    if (componentMask.count() != typeCount)
+    {
+        throw std::logic_error("EntityManager::CreateEntitiesWith: Component listed twice");
+    }
+    RequireComponents(componentMask);
+
+    // recycled indexes first, then one contiguous range sized in a single step
+    const auto first = entityPointers.size();
+    entityPointers.reserve(first + count);
+    for (std::size_t i = 0; i < reused; i++)
+    {
+        const auto index = mFreeIndexes.back();
+        mFreeIndexes.pop_back();
+        entityPointers.emplace_back(this, index, mVersions[index]);
+    }
+    const auto size = mVersions.size() + added;
+    mVersions.resize(size, mFirstVersion);
+    mSignatures.resize(size);
+    mEntityLocations.resize(size);
+    ResizeChangeSets();
+    for (std::size_t i = 0; i < added; i++)
+    {
+        const auto index = mNextIndex++;
+        entityPointers.emplace_back(this, index, mFirstVersion);
+    }
+
+    const auto archetypeMask = componentMask & mArchetypeComponents;
+    auto archetype = archetypeMask.any() ? GetOrCreateArchetype(archetypeMask) : nullptr;
+    for (std::size_t i = 0; i < typeCount; i++)
+    {
+        const auto typeId = typeIds[i];
+        if (mSparseSetComponents[typeId])
+        {
+            mSparseSets[typeId]->Reserve(mSparseSets[typeId]->Size() + count);
+        }
+        else if (!mArchetypeComponents[typeId])
+        {
+            mComponentPools[typeId]->Reserve(mComponentPools[typeId]->Size() + count);
+            if (mHeapComponents[typeId].size() < size)
+            {
+                mHeapComponents[typeId].resize(size, nullptr);
+            }
+        }
+    }
+    for (auto entity = first; entity < entityPointers.size(); entity++)
+    {
+        const auto index = entityPointers[entity].mIndex;
+        if (archetype != nullptr)
+        {
+            auto& location = mEntityLocations[index];
+            location.mArchetype = archetype;
+            location.mRow = archetype->AddRow(index);
+            for (std::size_t column = 0; column < archetype->GetColumnCount(); column++)
+            {
+                archetype->GetComponentInfo(column).mConstruct(archetype->GetComponent(location.mRow, column));
+            }
+        }
+        for (std::size_t i = 0; i < typeCount; i++)
+        {
+            const auto typeId = typeIds[i];
+            if (mSparseSetComponents[typeId])
+            {
+                mComponentInfos[typeId].mConstruct(mSparseSets[typeId]->Add(index));
+            }
+            else if (!mArchetypeComponents[typeId])
+            {
+                auto memory = mComponentPools[typeId]->Allocate();
+                mComponentInfos[typeId].mConstruct(memory);
+                mHeapComponents[typeId][index] = memory;
+            }
+            mChangedComponents[typeId].Set(index);
+        }
+        mSignatures[index] = componentMask;
+        SetEntityAlive(index, true);
+        mChangedEntities.Set(index);
+        UpdateQueries(index);
+    }
+
+    for (auto entity = first; entity < entityPointers.size(); entity++)
+    {
+        for (std::size_t i = 0; i < typeCount; i++)
+        {
+            EntityLoadComponent(GetStoredComponent(entityPointers[entity].mIndex, typeIds[i]), entityPointers[entity]);
+        }
+    }
+    for (auto entity = first; entity < entityPointers.size(); entity++)
+    {
+        EntityResolveComponentDependencies(entityPointers[entity]);
+    }
+}
+
+void EntityManager::DestroyEntity(Entity& entityPointer)
+{
+    AssertEntityPointerValid(entityPointer);
+    mVersions[entityPointer.mIndex] += 1;
+    auto& signature = mSignatures[entityPointer.mIndex];
+    // components still waiting in a snapshot have nothing to release, building them skips entities that lost them
+    const auto storedComponents = signature & ~mSnapshotComponents;
+    for (ComponentTypeId typeId = 0; typeId < mComponentInfos.size(); typeId++)
+    {
+        if (storedComponents[typeId] && mSparseSetComponents[typeId])
+        {
+            mSparseSets[typeId]->Remove(entityPointer.mIndex);
+        }
+        else if (storedComponents[typeId] && !mArchetypeComponents[typeId])
+        {
+            EntityReleaseHeapComponent(entityPointer.mIndex, typeId);
+        }
+    }
+    signature.reset();
+    if (mEntityLocations[entityPointer.mIndex].mArchetype != nullptr)
+    {
+        const auto& location = mEntityLocations[entityPointer.mIndex];
+        for (std::size_t column = 0; column < location.mArchetype->GetColumnCount(); column++)
+        {
+            location.mArchetype->GetComponentInfo(column).mDestroy(location.mArchetype->GetComponent(location.mRow, column));
+        }
+        EntityReleaseArchetypeRow(entityPointer.mIndex);
+    }
+    SetEntityAlive(entityPointer.mIndex, false);
+    mChangedEntities.Set(entityPointer.mIndex);
+    for (auto& query : mQueries)
+    {
+        query->Remove(entityPointer.mIndex);
+    }
+    if (mVersions[entityPointer.mIndex] != Entity::MaxVersion)
+    {
+        mFreeIndexes.push_back(entityPointer.mIndex);
+    }
+}
+
+void EntityManager::DestroyEntities(const std::vector<Entity>& entityPointers)
+{
+    DestroyEntities(entityPointers.begin(), entityPointers.end());
+}
+
+void EntityManager::DestroyEntityIndexes(std::vector<Entity::PointerSize>& indexes)
+{
+    // indexes are already marked dead, walking them in order keeps every storage pass sequential
+    if (!std::is_sorted(indexes.begin(), indexes.end()))
+    {
+        std::sort(indexes.begin(), indexes.end());
+    }
+    for (ComponentTypeId typeId = 0; typeId < mComponentInfos.size(); typeId++)
+    {
+        if (!IsComponentRegistered(typeId) || mArchetypeComponents[typeId] || mSnapshotComponents[typeId])
+        {
+            continue;
+        }
+        for (auto index : indexes)
+        {
+            if (!mSignatures[index][typeId])
+            {
+                continue;
+            }
+            if (mSparseSetComponents[typeId])
+            {
+                mSparseSets[typeId]->Remove(index);
+            }
+            else
+            {
+                EntityReleaseHeapComponent(index, typeId);
+            }
+        }
+    }
+    for (auto index : indexes)
+    {
+        const auto& location = mEntityLocations[index];
+        if (location.mArchetype != nullptr)
+        {
+            for (std::size_t column = 0; column < location.mArchetype->GetColumnCount(); column++)
+            {
+                location.mArchetype->GetComponentInfo(column).mDestroy(location.mArchetype->GetComponent(location.mRow, column));
+            }
+            EntityReleaseArchetypeRow(index);
+        }
+        mSignatures[index].reset();
+        mVersions[index] += 1;
+        mChangedEntities.Set(index);
+    }
+    for (auto& query : mQueries)
+    {
+        for (auto index : indexes)
+        {
+            query->Remove(index);
+        }
+    }
+    mFreeIndexes.reserve(mFreeIndexes.size() + indexes.size());
+    for (auto index : indexes)
+    {
+        if (mVersions[index] != Entity::MaxVersion)
+        {
+            mFreeIndexes.push_back(index);
+        }
+    }
+}
+
+void EntityManager::ConstructSystem(System* system)
+{
+    system->mManager = this;
+    system->OnLoad();
+}
+
+void EntityManager::ResolveSystemDependencies()
+{
+    for (auto& system : mSystems)
+    {
+        system->mUpdateAfter.clear();
+        system->OnResolveDependencies();
+    }
+}
+
+void EntityManager::Update(float dt)
+{
+    // systems run concurrently, nothing may be left to build lazily
+    RequireComponents(~ComponentMask{});
+    const auto order = GetSystemUpdateOrder();
+    auto& jobSystem = GetJobSystem();
+    std::vector<JobHandle> handles(mSystems.size());
+    std::vector<JobHandle> dependencies;
+    for (std::size_t i = 0; i < order.size(); i++)
+    {
+        auto system = mSystems[order[i]].get();
+        dependencies.clear();
+        for (std::size_t j = 0; j < i; j++)
+        {
+            const auto other = mSystems[order[j]].get();
+            const auto& updateAfter = system->mUpdateAfter;
+            if (SystemsConflict(*system, *other) || std::find(updateAfter.begin(), updateAfter.end(), other) != updateAfter.end())
+            {
+                dependencies.emplace_back(handles[order[j]]);
+            }
+        }
+        handles[order[i]] = jobSystem.Schedule([system, dt]
+                                               {
+                                                   system->OnUpdate(dt);
+                                               }, dependencies);
+    }
+    // every system must be done before returning, even when one of them threw
+    std::exception_ptr exception;
+    for (const auto& handle : handles)
+    {
+        try
+        {
+            jobSystem.Wait(handle);
+        }
+        catch (...)
+        {
+            if (exception == nullptr)
+            {
+                exception = std::current_exception();
+            }
+        }
+    }
+    if (exception != nullptr)
+    {
+        std::rethrow_exception(exception);
+    }
+}
+
+std::vector<std::size_t> EntityManager::GetSystemUpdateOrder() const
+{
+    // registration order, except that a system is moved after the systems it asked to update after
+    std::unordered_map<const System*, std::size_t> indexes;
+    for (std::size_t i = 0; i < mSystems.size(); i++)
+    {
+        indexes[mSystems[i].get()] = i;
+    }
+    std::vector<std::size_t> order;
+    std::vector<bool> placed(mSystems.size(), false);
+    while (order.size() < mSystems.size())
+    {
+        auto next = mSystems.size();
+        for (std::size_t i = 0; i < mSystems.size() && next == mSystems.size(); i++)
+        {
+            const auto& updateAfter = mSystems[i]->mUpdateAfter;
+            const auto ready = std::all_of(updateAfter.begin(), updateAfter.end(), [&](const System* system)
+            {
+                auto found = indexes.find(system);
+                return found == indexes.end() || placed[found->second];
+            });
+            if (!placed[i] && ready)
+            {
+                next = i;
+            }
+        }
+        if (next == mSystems.size())
+        {
+            throw std::logic_error("EntityManager::Update: Systems update order has a cycle");
+        }
+        placed[next] = true;
+        order.emplace_back(next);
+    }
+    return order;
+}
+
+void EntityManager::Serialize(std::ostream& os, SnapshotCompression compression) const
+{
+    SnapshotImage image;
+    CaptureSnapshot(image, false);
+    WriteSnapshot(image, os, compression);
+}
+
+std::future<void> EntityManager::SerializeAsync(std::ostream& os, SnapshotCompression compression) const
+{
+    auto image = std::make_shared<SnapshotImage>();
+    CaptureSnapshot(*image, true);
+    // a thread of its own, a slow sink must not hold up a job system worker
+    return std::async(std::launch::async, [image, &os, compression]
+    {
+        EncodeSnapshot(*image);
+        WriteSnapshot(*image, os, compression);
+        if (!os)
+        {
+            throw std::logic_error("EntityManager::SerializeAsync: Failed to write the snapshot");
+        }
+    });
+}
+
+void EntityManager::CaptureSnapshot(SnapshotImage& image, bool deferred) const
+{
+    RequireComponents(~ComponentMask{});
+    const auto slotCount = mVersions.size();
+    image.mVersions = mVersions;
+    image.mAliveEntities = mAliveEntities;
+    image.mAliveEntities.resize((slotCount + 63u) / 64u);
+    image.mFreeIndexes = mFreeIndexes;
+
+    // entity indexes of every component type, in ascending order
+    std::vector<std::vector<Entity::PointerSize>> componentIndexes(mComponentInfos.size());
+    for (auto index = FindAliveIndex(0); index < slotCount; index = FindAliveIndex(index + 1))
+    {
+        const auto& signature = mSignatures[index];
+        for (ComponentTypeId typeId = 0; typeId < mComponentInfos.size(); typeId++)
+        {
+            if (signature[typeId])
+            {
+                componentIndexes[typeId].emplace_back(static_cast<Entity::PointerSize>(index));
+            }
+        }
+    }
+    image.mComponents.clear();
+    for (ComponentTypeId typeId = 0; typeId < componentIndexes.size(); typeId++)
+    {
+        if (componentIndexes[typeId].empty())
+        {
+            continue;
+        }
+        image.mComponents.emplace_back();
+        auto& block = image.mComponents.back();
+        const auto& componentInfo = mComponentInfos[typeId];
+        block.mName = componentInfo.mName;
+        block.mDataSize = static_cast<std::uint32_t>(componentInfo.mDataSize);
+        if (deferred && componentInfo.mDataSize == 0 && componentInfo.mSerialized && componentInfo.mCopy != nullptr && componentInfo.mAlignment <= alignof(std::max_align_t))
+        {
+            block.mCopies = std::make_unique<ComponentCopies>(componentInfo, componentIndexes[typeId].size());
+            for (auto index : componentIndexes[typeId])
+            {
+                block.mCopies->Add(GetStoredComponent(index, typeId));
+            }
+        }
+        else
+        {
+            SerializeComponents(typeId, componentIndexes[typeId], block.mPayload);
+        }
+        block.mIndexes = std::move(componentIndexes[typeId]);
+    }
+}
+
+void EntityManager::EncodeSnapshot(SnapshotImage& image)
+{
+    for (auto& block : image.mComponents)
+    {
+        if (!block.mCopies)
+        {
+            continue;
+        }
+        std::ostringstream stream(std::ios::out | std::ios::binary);
+        for (std::size_t position = 0; position < block.mCopies->Size(); position++)
+        {
+            block.mCopies->Get(position)->Serialize(stream);
+        }
+        block.mPayload = stream.str();
+        block.mCopies.reset();
+    }
+}
+
+void EntityManager::WriteSnapshot(const SnapshotImage& image, std::ostream& os, SnapshotCompression compression)
+{
+    if (compression == SnapshotCompression::eBlock)
+    {
+        std::ostringstream stream(std::ios::out | std::ios::binary);
+        WriteSnapshot(image, stream, SnapshotCompression::eNone);
+        WriteCompressedSnapshot(stream.str(), os);
+        return;
+    }
+    os.write(SnapshotMagic, sizeof(SnapshotMagic));
+    WriteValue(os, SnapshotVersion);
+    WriteValue(os, static_cast<std::uint32_t>(sizeof(Entity::PointerSize)));
+    WriteValue(os, static_cast<std::uint64_t>(image.mVersions.size()));
+    WriteValues(os, image.mVersions.data(), image.mVersions.size());
+    WriteValues(os, image.mAliveEntities.data(), image.mAliveEntities.size());
+    WriteValue(os, static_cast<std::uint64_t>(image.mFreeIndexes.size()));
+    WriteValues(os, image.mFreeIndexes.data(), image.mFreeIndexes.size());
+
+    WriteValue(os, static_cast<std::uint32_t>(image.mComponents.size()));
+    for (const auto& block : image.mComponents)
+    {
+        WriteValue(os, static_cast<std::uint32_t>(block.mName.size()));
+        os.write(block.mName.data(), block.mName.size());
+    }
+    for (const auto& block : image.mComponents)
+    {
+        WriteValue(os, static_cast<std::uint32_t>(block.mDataSize != 0 ? SnapshotEncoding::eData : SnapshotEncoding::eStream));
+        WriteValue(os, block.mDataSize);
+        WriteValue(os, static_cast<std::uint64_t>(block.mIndexes.size()));
+        WriteValues(os, block.mIndexes.data(), block.mIndexes.size());
+        WriteValue(os, static_cast<std::uint64_t>(block.mPayload.size()));
+        os.write(block.mPayload.data(), block.mPayload.size());
+    }
+}
+
+void EntityManager::WriteComponentNames(std::ostream& os, const std::vector<ComponentTypeId>& typeIds) const
+{
+    WriteValue(os, static_cast<std::uint32_t>(typeIds.size()));
+    for (auto typeId : typeIds)
+    {
+        const auto& name = mComponentInfos[typeId].mName;
+        WriteValue(os, static_cast<std::uint32_t>(name.size()));
+        os.write(name.data(), name.size());
+    }
+}
+
+std::vector<ComponentTypeId> EntityManager::ReadComponentNames(SnapshotReader& reader) const
+{
+    // every type is listed once and must be registered
+    const auto typeCount = ReadValue<std::uint32_t>(reader);
+    if (typeCount > mComponentInfos.size())
+    {
+        throw std::logic_error("EntityManager::ReadComponentNames: Corrupted component name table");
+    }
+    std::vector<ComponentTypeId> typeIds(typeCount);
+    std::string componentName;
+    for (auto& typeId : typeIds)
+    {
+        ReadContainer(reader, componentName, ReadValue<std::uint32_t>(reader));
+        auto found = mRegisteredComponents.find(componentName);
+        if (found == mRegisteredComponents.end())
+        {
+            throw std::logic_error(componentName + std::string{ " is not registered" });
+        }
+        typeId = found->second;
+    }
+    return typeIds;
+}
+
+void EntityManager::SerializeComponents(ComponentTypeId typeId, const std::vector<Entity::PointerSize>& indexes, std::string& payload) const
+{
+    const auto& componentInfo = mComponentInfos[typeId];
+    if (componentInfo.mDataSize != 0)
+    {
+        payload.resize(componentInfo.mDataSize * indexes.size());
+        for (std::size_t i = 0; i < indexes.size(); i++)
+        {
+            std::memcpy(&payload[componentInfo.mDataSize * i], componentInfo.mGetData(GetStoredComponent(indexes[i], typeId)), componentInfo.mDataSize);
+        }
+    }
+    else if (!componentInfo.mSerialized)
+    {
+        payload.clear();
+    }
+    else
+    {
+        std::ostringstream stream(std::ios::out | std::ios::binary);
+        for (auto index : indexes)
+        {
+            GetStoredComponent(index, typeId)->Serialize(stream);
+        }
+        payload = stream.str();
+    }
+}
+
+void EntityManager::Deserialize(std::istream& is)
+{
+    const auto reader = ReadSnapshot(std::make_unique<SnapshotStreamReader>(is));
+    BuildSnapshotComponents(mSnapshotComponents);
+    ClearChanges();
+}
+
+void EntityManager::LoadSnapshot(const std::string& path)
+{
+    mSnapshotReader = ReadSnapshot(std::make_unique<SnapshotFile>(path));
+    BuildSnapshotComponents(mSnapshotComponents & mArchetypeComponents);
+    ClearChanges();
+}
+
+std::unique_ptr<SnapshotReader> EntityManager::ReadSnapshot(std::unique_ptr<SnapshotReader> reader)
+{
+    Clear();
+    try
+    {
+        char magic[sizeof(SnapshotMagic)];
+        reader->Read(magic, sizeof(magic));
+        if (IsCompressedSnapshot(magic, sizeof(magic)))
+        {
+            reader = ReadCompressedSnapshot(*reader, &GetJobSystem());
+            reader->Read(magic, sizeof(magic));
+        }
+        if (!std::equal(magic, magic + sizeof(magic), SnapshotMagic))
+        {
+            throw std::logic_error("EntityManager::Deserialize: Not a snapshot");
+        }
+        ReadSnapshotEntities(*reader);
+    }
+    catch (...)
+    {
+        // the blocks read so far point into the reader
+        Clear();
+        throw;
+    }
+    // the blocks of the components not built yet point into the returned reader
+    return reader;
+}
+
+void EntityManager::ReadSnapshotEntities(SnapshotReader& reader)
+{
+    if (ReadValue<std::uint32_t>(reader) != SnapshotVersion)
+    {
+        throw std::logic_error("EntityManager::Deserialize: Unsupported snapshot version");
+    }
+    if (ReadValue<std::uint32_t>(reader) != sizeof(Entity::PointerSize))
+    {
+        throw std::logic_error("EntityManager::Deserialize: Snapshot saved with another ALIVE_ECS_ENTITY_POINTER_BITS");
+    }
+    const auto slotCount = ReadValue<std::uint64_t>(reader);
+    if (slotCount > Entity::MaxIndex)
+    {
+        throw std::logic_error("EntityManager::Deserialize: Corrupted snapshot");
+    }
+    ReadContainer(reader, mVersions, slotCount);
+    ReadContainer(reader, mAliveEntities, (slotCount + 63u) / 64u);
+    if (slotCount % 64u != 0)
+    {
+        mAliveEntities.back() &= ~(~std::uint64_t{ 0 } << (slotCount % 64u));
+    }
+    for (auto word : mAliveEntities)
+    {
+        mAliveCount += std::bitset<64>(word).count();
+    }
+    const auto freeCount = ReadValue<std::uint64_t>(reader);
+    if (freeCount > slotCount)
+    {
+        throw std::logic_error("EntityManager::Deserialize: Corrupted snapshot");
+    }
+    ReadContainer(reader, mFreeIndexes, freeCount);
+    mNextIndex = static_cast<Entity::PointerSize>(slotCount);
+    mSignatures.resize(slotCount);
+    mEntityLocations.resize(slotCount);
+    ResizeChangeSets();
+    for (auto index : mFreeIndexes)
+    {
+        if (index >= slotCount || FindAliveIndex(index) == index)
+        {
+            throw std::logic_error("EntityManager::Deserialize: Corrupted snapshot");
+        }
+    }
+
+    const auto typeIds = ReadComponentNames(reader);
+    mSnapshotBlocks.resize(mComponentInfos.size());
+    for (auto typeId : typeIds)
+    {
+        const auto& componentInfo = mComponentInfos[typeId];
+        auto& block = mSnapshotBlocks[typeId];
+        block.mData = static_cast<SnapshotEncoding>(ReadValue<std::uint32_t>(reader)) == SnapshotEncoding::eData;
+        const auto dataSize = ReadValue<std::uint32_t>(reader);
+        const auto indexCount = ReadValue<std::uint64_t>(reader);
+        if (indexCount > slotCount)
+        {
+            throw std::logic_error("EntityManager::Deserialize: Corrupted snapshot");
+        }
+        ReadContainer(reader, block.mIndexes, indexCount);
+        block.mPayloadByteSize = ReadValue<std::uint64_t>(reader);
+        if (block.mData && (dataSize != componentInfo.mDataSize || block.mPayloadByteSize != dataSize * block.mIndexes.size()))
+        {
+            throw std::logic_error(std::string{ "EntityManager::Deserialize: Component " } + componentInfo.mName + std::string{ " data size changed" });
+        }
+        block.mPayload = reader.ReadBlock(block.mPayloadByteSize);
+        for (auto index : block.mIndexes)
+        {
+            if (index >= slotCount || FindAliveIndex(index) != index || mSignatures[index][typeId])
+            {
+                throw std::logic_error("EntityManager::Deserialize: Corrupted snapshot");
+            }
+            mSignatures[index].set(typeId);
+        }
+        mSnapshotComponents.set(typeId);
+    }
+
+    // every entity is placed in its final archetype at once, archetype components are built right away
+    Archetype* archetype = nullptr;
+    for (auto index = FindAliveIndex(0); index < slotCount; index = FindAliveIndex(index + 1))
+    {
+        const auto archetypeMask = mSignatures[index] & mArchetypeComponents;
+        if (archetypeMask.any())
+        {
+            if (archetype == nullptr || archetype->GetComponentMask() != archetypeMask)
+            {
+                archetype = GetOrCreateArchetype(archetypeMask);
+            }
+            auto& location = mEntityLocations[index];
+            location.mArchetype = archetype;
+            location.mRow = archetype->AddRow(static_cast<Entity::PointerSize>(index));
+            for (std::size_t column = 0; column < archetype->GetColumnCount(); column++)
+            {
+                archetype->GetComponentInfo(column).mConstruct(archetype->GetComponent(location.mRow, column));
+            }
+        }
+        UpdateQueries(static_cast<Entity::PointerSize>(index));
+    }
+}
+
+void EntityManager::BuildSnapshotComponents(const ComponentMask& componentMask)
+{
+    // the types are marked built first so the callbacks below can reach any of them,
+    // they only run in parallel once no type is left for them to build
+    const auto builtComponents = componentMask & mSnapshotComponents;
+    mSnapshotComponents &= ~builtComponents;
+    const auto parallel = mParallelSnapshotLoad && mSnapshotComponents.none();
+    for (ComponentTypeId typeId = 0; typeId < mSnapshotBlocks.size(); typeId++)
+    {
+        if (!builtComponents[typeId])
+        {
+            continue;
+        }
+        const auto& componentInfo = mComponentInfos[typeId];
+        const auto& block = mSnapshotBlocks[typeId];
+        SnapshotStreamBuffer buffer(block.mPayload, block.mPayloadByteSize);
+        std::istream stream(&buffer);
+        if (mSparseSetComponents[typeId])
+        {
+            mSparseSets[typeId]->Reserve(mSparseSets[typeId]->Size() + block.mIndexes.size());
+        }
+        else if (!mArchetypeComponents[typeId])
+        {
+            mComponentPools[typeId]->Reserve(mComponentPools[typeId]->Size() + block.mIndexes.size());
+            if (mHeapComponents[typeId].size() < mVersions.size())
+            {
+                mHeapComponents[typeId].resize(mVersions.size(), nullptr);
+            }
+        }
+        for (std::size_t i = 0; i < block.mIndexes.size(); i++)
+        {
+            const auto index = block.mIndexes[i];
+            Component* component;
+            // entities destroyed or stripped of the component since the snapshot was read are skipped,
+            // stream payloads are still read through to keep the next component in step
+            if (index >= mSignatures.size() || !mSignatures[index][typeId])
+            {
+                if (!block.mData)
+                {
+                    componentInfo.mCreate()->Deserialize(stream);
+                }
+                continue;
+            }
+            if (mSparseSetComponents[typeId])
+            {
+                component = componentInfo.mConstruct(mSparseSets[typeId]->Add(index));
+            }
+            else if (mArchetypeComponents[typeId])
+            {
+                component = GetStoredComponent(index, typeId);
+            }
+            else
+            {
+                auto memory = mComponentPools[typeId]->Allocate();
+                component = componentInfo.mConstruct(memory);
+                mHeapComponents[typeId][index] = memory;
+            }
+            if (block.mData)
+            {
+                std::memcpy(componentInfo.mGetData(component), block.mPayload + componentInfo.mDataSize * i, componentInfo.mDataSize);
+            }
+            else
+            {
+                component->Deserialize(stream);
+            }
+        }
+    }
+
+    // every component is in place before the first OnLoad, and every OnLoad ran before the first OnResolveDependencies
+    std::vector<Entity::PointerSize> indexes;
+    for (auto index = FindAliveIndex(0); index < mVersions.size(); index = FindAliveIndex(index + 1))
+    {
+        if ((mSignatures[index] & builtComponents).any())
+        {
+            indexes.emplace_back(static_cast<Entity::PointerSize>(index));
+        }
+    }
+    const auto construct = [this, &indexes, &builtComponents](std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; i++)
+        {
+            const Entity entityPointer{ this, indexes[i], mVersions[indexes[i]] };
+            EntityForEachComponent(entityPointer.mIndex, mSignatures[entityPointer.mIndex] & builtComponents, [this, &entityPointer](const ComponentInfo&, Component* component)
+            {
+                EntityLoadComponent(component, entityPointer);
+            });
+        }
+    };
+    const auto resolve = [this, &indexes, &builtComponents](std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; i++)
+        {
+            EntityForEachComponent(indexes[i], mSignatures[indexes[i]] & builtComponents, [](const ComponentInfo&, Component* component)
+            {
+                component->OnResolveDependencies();
+            });
+        }
+    };
+    if (parallel)
+    {
+        static constexpr std::size_t GrainSize = 1024;
+        auto& jobSystem = GetJobSystem();
+        jobSystem.Wait(jobSystem.ScheduleParallelFor(indexes.size(), GrainSize, construct));
+        jobSystem.Wait(jobSystem.ScheduleParallelFor(indexes.size(), GrainSize, resolve));
+    }
+    else
+    {
+        construct(0, indexes.size());
+        resolve(0, indexes.size());
+    }
+
+    for (ComponentTypeId typeId = 0; typeId < mSnapshotBlocks.size(); typeId++)
+    {
+        if (builtComponents[typeId])
+        {
+            mSnapshotBlocks[typeId] = SnapshotBlock{};
+        }
+    }
+    if (mSnapshotComponents.none())
+    {
+        mSnapshotBlocks.clear();
+        mSnapshotReader.reset();
+    }
+}
+
+void EntityManager::ClearChanges()
+{
+    mChangedEntities.Clear();
+    for (auto& changedComponents : mChangedComponents)
+    {
+        changedComponents.Clear();
+    }
+}
+
+void EntityManager::SerializeDelta(std::ostream& os) const
+{
+    RequireComponents(~ComponentMask{});
+    const auto slotCount = mVersions.size();
+    os.write(DeltaMagic, sizeof(DeltaMagic));
+    WriteValue(os, SnapshotVersion);
+    WriteValue(os, static_cast<std::uint32_t>(sizeof(Entity::PointerSize)));
+    WriteValue(os, static_cast<std::uint64_t>(slotCount));
+    WriteValue(os, mFirstVersion);
+
+    // slots created, destroyed or recycled with their current version and state, then the whole free list
+    std::vector<Entity::PointerSize> indexes;
+    for (std::size_t index = 0; index < slotCount; index++)
+    {
+        if (mChangedEntities.Test(index))
+        {
+            indexes.emplace_back(static_cast<Entity::PointerSize>(index));
+        }
+    }
+    std::vector<Entity::PointerSize> versions(indexes.size());
+    std::vector<std::uint8_t> aliveEntities(indexes.size());
+    for (std::size_t i = 0; i < indexes.size(); i++)
+    {
+        versions[i] = mVersions[indexes[i]];
+        aliveEntities[i] = FindAliveIndex(indexes[i]) == indexes[i] ? 1 : 0;
+    }
+    WriteValue(os, static_cast<std::uint64_t>(indexes.size()));
+    WriteValues(os, indexes.data(), indexes.size());
+    WriteValues(os, versions.data(), versions.size());
+    WriteValues(os, aliveEntities.data(), aliveEntities.size());
+    WriteValue(os, static_cast<std::uint64_t>(mFreeIndexes.size()));
+    WriteValues(os, mFreeIndexes.data(), mFreeIndexes.size());
+
+    // per type the alive entities that lost the component, then the ones holding a new or changed one
+    std::vector<std::vector<Entity::PointerSize>> removedIndexes(mComponentInfos.size());
+    std::vector<std::vector<Entity::PointerSize>> changedIndexes(mComponentInfos.size());
+    std::vector<ComponentTypeId> typeIds;
+    for (ComponentTypeId typeId = 0; typeId < mComponentInfos.size(); typeId++)
+    {
+        if (!IsComponentRegistered(typeId))
+        {
+            continue;
+        }
+        const auto& changedComponents = mChangedComponents[typeId];
+        for (std::size_t index = 0; index < slotCount; index++)
+        {
+            if (changedComponents.Test(index) && FindAliveIndex(index) == index)
+            {
+                (mSignatures[index][typeId] ? changedIndexes : removedIndexes)[typeId].emplace_back(static_cast<Entity::PointerSize>(index));
+            }
+        }
+        if (!removedIndexes[typeId].empty() || !changedIndexes[typeId].empty())
+        {
+            typeIds.emplace_back(typeId);
+        }
+    }
+    WriteComponentNames(os, typeIds);
+
+    std::string payload;
+    for (auto typeId : typeIds)
+    {
+        const auto& componentInfo = mComponentInfos[typeId];
+        SerializeComponents(typeId, changedIndexes[typeId], payload);
+        WriteValue(os, static_cast<std::uint32_t>(componentInfo.mDataSize != 0 ? SnapshotEncoding::eData : SnapshotEncoding::eStream));
+        WriteValue(os, static_cast<std::uint32_t>(componentInfo.mDataSize));
+        WriteValue(os, static_cast<std::uint64_t>(removedIndexes[typeId].size()));
+        WriteValues(os, removedIndexes[typeId].data(), removedIndexes[typeId].size());
+        WriteValue(os, static_cast<std::uint64_t>(changedIndexes[typeId].size()));
+        WriteValues(os, changedIndexes[typeId].data(), changedIndexes[typeId].size());
+        WriteValue(os, static_cast<std::uint64_t>(payload.size()));
+        os.write(payload.data(), payload.size());
+    }
+}
+
+void EntityManager::ApplyDelta(std::istream& is)
+{
+    RequireComponents(~ComponentMask{});
+    SnapshotStreamReader reader(is);
+    try
+    {
+        ReadDelta(reader);
+    }
+    catch (...)
+    {
+        // part of the delta may already be applied
+        Clear();
+        throw;
+    }
+    ClearChanges();
+}
+
+void EntityManager::ReadDelta(SnapshotReader& reader)
+{
+    char magic[sizeof(DeltaMagic)];
+    reader.Read(magic, sizeof(magic));
+    if (!std::equal(magic, magic + sizeof(magic), DeltaMagic))
+    {
+        throw std::logic_error("EntityManager::ApplyDelta: Not a delta");
+    }
+    if (ReadValue<std::uint32_t>(reader) != SnapshotVersion)
+    {
+        throw std::logic_error("EntityManager::ApplyDelta: Unsupported delta version");
+    }
+    if (ReadValue<std::uint32_t>(reader) != sizeof(Entity::PointerSize))
+    {
+        throw std::logic_error("EntityManager::ApplyDelta: Delta saved with another ALIVE_ECS_ENTITY_POINTER_BITS");
+    }
+    const auto slotCount = ReadValue<std::uint64_t>(reader);
+    const auto firstVersion = ReadValue<Entity::PointerSize>(reader);
+    const auto changedCount = ReadValue<std::uint64_t>(reader);
+    // every slot past the current ones was created since the baseline, so it is listed as changed
+    if (slotCount > Entity::MaxIndex || changedCount > slotCount || slotCount > mVersions.size() + changedCount)
+    {
+        throw std::logic_error("EntityManager::ApplyDelta: Corrupted delta");
+    }
+    std::vector<Entity::PointerSize> indexes;
+    std::vector<Entity::PointerSize> versions;
+    std::vector<std::uint8_t> aliveEntities;
+    ReadContainer(reader, indexes, changedCount);
+    ReadContainer(reader, versions, changedCount);
+    ReadContainer(reader, aliveEntities, changedCount);
+    for (std::size_t i = 0; i < indexes.size(); i++)
+    {
+        if (indexes[i] >= slotCount || (i > 0 && indexes[i] <= indexes[i - 1]))
+        {
+            throw std::logic_error("EntityManager::ApplyDelta: Corrupted delta");
+        }
+    }
+
+    // entities gone or replaced since the baseline are destroyed first, slots past the new end included
+    if (slotCount > mVersions.size())
+    {
+        mVersions.resize(slotCount, mFirstVersion);
+        mSignatures.resize(slotCount);
+        mEntityLocations.resize(slotCount);
+        mAliveEntities.resize((slotCount + 63u) / 64u);
+        ResizeChangeSets();
+    }
+    std::vector<Entity::PointerSize> destroyedIndexes;
+    for (std::size_t i = 0; i < indexes.size(); i++)
+    {
+        const auto index = indexes[i];
+        if (FindAliveIndex(index) == index && (aliveEntities[i] == 0 || mVersions[index] != versions[i]))
+        {
+            destroyedIndexes.emplace_back(index);
+        }
+    }
+    for (auto index = FindAliveIndex(slotCount); index < mVersions.size(); index = FindAliveIndex(index + 1))
+    {
+        destroyedIndexes.emplace_back(static_cast<Entity::PointerSize>(index));
+    }
+    for (auto index : destroyedIndexes)
+    {
+        SetEntityAlive(index, false);
+    }
+    DestroyEntityIndexes(destroyedIndexes);
+    for (std::size_t i = 0; i < indexes.size(); i++)
+    {
+        mVersions[indexes[i]] = versions[i];
+        SetEntityAlive(indexes[i], aliveEntities[i] != 0);
+    }
+    if (slotCount < mVersions.size())
+    {
+        mVersions.resize(slotCount);
+        mSignatures.resize(slotCount);
+        mEntityLocations.resize(slotCount);
+        mAliveEntities.resize((slotCount + 63u) / 64u);
+        for (auto& components : mHeapComponents)
+        {
+            components.resize(std::min<std::size_t>(components.size(), slotCount));
+        }
+    }
+    mNextIndex = static_cast<Entity::PointerSize>(slotCount);
+    mFirstVersion = firstVersion;
+    const auto freeCount = ReadValue<std::uint64_t>(reader);
+    if (freeCount > slotCount)
+    {
+        throw std::logic_error("EntityManager::ApplyDelta: Corrupted delta");
+    }
+    ReadContainer(reader, mFreeIndexes, freeCount);
+    for (auto index : mFreeIndexes)
+    {
+        if (index >= slotCount || FindAliveIndex(index) == index)
+        {
+            throw std::logic_error("EntityManager::ApplyDelta: Corrupted delta");
+        }
+    }
+    for (std::size_t i = 0; i < indexes.size(); i++)
+    {
+        if (aliveEntities[i] != 0)
+        {
+            UpdateQueries(indexes[i]);
+        }
+    }
+
+    // components are removed, added or overwritten in place, OnLoad waits until every type is placed
+    std::vector<std::pair<Entity::PointerSize, ComponentTypeId>> addedComponents;
+    std::vector<Entity::PointerSize> removedIndexes;
+    std::vector<Entity::PointerSize> changedIndexes;
+    for (auto typeId : ReadComponentNames(reader))
+    {
+        const auto& componentInfo = mComponentInfos[typeId];
+        const auto data = static_cast<SnapshotEncoding>(ReadValue<std::uint32_t>(reader)) == SnapshotEncoding::eData;
+        const auto dataSize = ReadValue<std::uint32_t>(reader);
+        const auto removedCount = ReadValue<std::uint64_t>(reader);
+        if (removedCount > slotCount)
+        {
+            throw std::logic_error("EntityManager::ApplyDelta: Corrupted delta");
+        }
+        ReadContainer(reader, removedIndexes, removedCount);
+        const auto changedComponentCount = ReadValue<std::uint64_t>(reader);
+        if (changedComponentCount > slotCount)
+        {
+            throw std::logic_error("EntityManager::ApplyDelta: Corrupted delta");
+        }
+        ReadContainer(reader, changedIndexes, changedComponentCount);
+        const auto payloadByteSize = ReadValue<std::uint64_t>(reader);
+        if (data && (dataSize != componentInfo.mDataSize || payloadByteSize != dataSize * changedIndexes.size()))
+        {
+            throw std::logic_error(std::string{ "EntityManager::ApplyDelta: Component " } + componentInfo.mName + std::string{ " data size changed" });
+        }
+        const auto payload = reader.ReadBlock(payloadByteSize);
+        for (auto index : removedIndexes)
+        {
+            if (index >= slotCount || FindAliveIndex(index) != index)
+            {
+                throw std::logic_error("EntityManager::ApplyDelta: Corrupted delta");
+            }
+            if (mSignatures[index][typeId])
+            {
+                EntityRemoveStoredComponent(Entity{ this, index, mVersions[index] }, typeId);
+            }
+        }
+        SnapshotStreamBuffer buffer(payload, payloadByteSize);
+        std::istream stream(&buffer);
+        for (std::size_t i = 0; i < changedIndexes.size(); i++)
+        {
+            const auto index = changedIndexes[i];
+            if (index >= slotCount || FindAliveIndex(index) != index)
+            {
+                throw std::logic_error("EntityManager::ApplyDelta: Corrupted delta");
+            }
+            Component* component;
+            if (mSignatures[index][typeId])
+            {
+                component = GetStoredComponent(index, typeId);
+            }
+            else
+            {
+                component = EntityAddStoredComponent(Entity{ this, index, mVersions[index] }, componentInfo);
+                addedComponents.emplace_back(index, typeId);
+            }
+            if (data)
+            {
+                std::memcpy(componentInfo.mGetData(component), payload + componentInfo.mDataSize * i, componentInfo.mDataSize);
+            }
+            else
+            {
+                component->Deserialize(stream);
+            }
+        }
+    }
+
+    std::vector<Entity::PointerSize> resolvedIndexes;
+    for (const auto& added : addedComponents)
+    {
+        EntityLoadComponent(GetStoredComponent(added.first, added.second), Entity{ this, added.first, mVersions[added.first] });
+        resolvedIndexes.emplace_back(added.first);
+    }
+    std::sort(resolvedIndexes.begin(), resolvedIndexes.end());
+    resolvedIndexes.erase(std::unique(resolvedIndexes.begin(), resolvedIndexes.end()), resolvedIndexes.end());
+    for (auto index : resolvedIndexes)
+    {
+        EntityResolveComponentDependencies(Entity{ this, index, mVersions[index] });
+    }
+}
+
+void EntityManager::ResizeChangeSets()
+{
+    // sized to the capacity of the slot tables so creating entities one by one rarely walks every type
+    if (mVersions.size() <= mChangedEntities.Size())
     {
-        index = mNextIndex++;
-        mVersions.resize(index + 1);
-        mEntityComponents.resize(index + 1);
-        version = mVersions[index] = 1;
+        return;
     }
-    else
+    const auto size = mVersions.capacity();
+    mChangedEntities.Resize(size);
+    for (auto& changedComponents : mChangedComponents)
     {
-        index = mFreeIndexes.back();
-        version = mVersions[index];
-        mFreeIndexes.pop_back();
+        changedComponents.Resize(size);
     }
-    return { this, index, version };
 }
 
-void EntityManager::DestroyEntity(Entity& entityPointer)
+bool EntityManager::IsEntityPointerValid(const Entity& entityPointer) const
 {
-    AssertEntityPointerValid(entityPointer);
-    mVersions[entityPointer.mIndex] += 1;
-    mEntityComponents[entityPointer.mIndex].clear();
-    mFreeIndexes.push_back(entityPointer.mIndex);
+    return entityPointer.mIndex < mVersions.size() && mVersions[entityPointer.mIndex] == entityPointer.mVersion;
 }
 
-void EntityManager::ConstructSystem(System* system)
+void EntityManager::AssertEntityPointerValid(const Entity& entityPointer) const
 {
-    system->mManager = this;
-    system->OnLoad();
+    if (!IsEntityPointerValid(entityPointer))
+    {
+        std::stringstream errorFormat;
+        errorFormat << "Entity invalid: " << entityPointer.mIndex << "(" << entityPointer.mIndex << ")";
+        throw std::logic_error(errorFormat.str());
+    }
 }
 
-void EntityManager::ResolveSystemDependencies()
+void EntityManager::SetEntityAlive(Entity::PointerSize index, bool alive)
 {
-    for (auto& system : mSystems)
+    const auto word = index / 64u;
+    if (word >= mAliveEntities.size())
     {
-        system->OnResolveDependencies();
+        mAliveEntities.resize(word + 1);
+    }
+    const auto bit = std::uint64_t{ 1 } << (index % 64u);
+    if (alive && (mAliveEntities[word] & bit) == 0)
+    {
+        mAliveEntities[word] |= bit;
+        mAliveCount += 1;
     }
+    else if (!alive && (mAliveEntities[word] & bit) != 0)
+    {
+        mAliveEntities[word] &= ~bit;
+        mAliveCount -= 1;
+    }
+}
+
+void EntityManager::EntityConstructComponent(Component* component, const Entity& entityPointer)
+{
+    EntityLoadComponent(component, entityPointer);
+    component->OnResolveDependencies();
+}
+
+void EntityManager::EntityLoadComponent(Component* component, const Entity& entityPointer)
+{
+    AssertEntityPointerValid(entityPointer);
+    component->mEntity = entityPointer;
+    component->OnLoad();
+}
+
+void EntityManager::EntityResolveComponentDependencies(const Entity& entityPointer)
+{
+    AssertEntityPointerValid(entityPointer);
+    RequireComponents(mSignatures[entityPointer.mIndex]);
+    EntityForEachComponent(entityPointer.mIndex, [](const ComponentInfo&, Component* component)
+    {
+        component->OnResolveDependencies();
+    });
 }
 
-void EntityManager::Serialize(std::ostream& os) const
+Component* EntityManager::GetStoredComponent(Entity::PointerSize index, ComponentTypeId typeId) const
 {
-    for (auto entityPointer : *this)
+    const auto& componentInfo = mComponentInfos[typeId];
+    switch (componentInfo.mStorage)
     {
-        os << '{';
-        os.write(reinterpret_cast<char*>(&entityPointer.mIndex), sizeof(entityPointer.mIndex));
-        os.write(reinterpret_cast<char*>(&entityPointer.mVersion), sizeof(entityPointer.mVersion));
-        for (const auto& component : mEntityComponents[entityPointer.mIndex])
+        case ComponentStorage::eArchetype:
         {
-            os.write(component->GetComponentName().c_str(), 1 + component->GetComponentName().size());
-            component->Serialize(os);
+            const auto& location = mEntityLocations[index];
+            const auto column = static_cast<std::size_t>(location.mArchetype->FindColumn(typeId));
+            return componentInfo.mGet(location.mArchetype->GetComponent(location.mRow, column));
         }
-        os << '}';
+        case ComponentStorage::eSparseSet:
+            return componentInfo.mGet(mSparseSets[typeId]->Get(index));
+        case ComponentStorage::eHeap:
+        default:
+            return componentInfo.mGet(mHeapComponents[typeId][index]);
     }
 }
 
-void EntityManager::Deserialize(std::istream& is)
+Component* EntityManager::EntityAddStoredComponent(const Entity& entityPointer, const ComponentInfo& componentInfo)
 {
-    Clear();
-    enum class ParsingState
-    {
-        eEntity,
-        eComponentName,
-    };
-    auto state = ParsingState::eEntity;
-    std::unique_ptr<Entity> entityPointer;
-    std::string componentName;
-    while (!is.eof())
+    const auto typeId = componentInfo.mTypeId;
+    RequireComponents(ComponentMask{}.set(typeId));
+    Component* componentPtr;
+    switch (componentInfo.mStorage)
     {
-        char token;
-        is >> token;
-        if (state == ParsingState::eEntity)
+        case ComponentStorage::eArchetype:
+            componentPtr = EntityAddArchetypeComponent(entityPointer, typeId);
+            break;
+        case ComponentStorage::eSparseSet:
+            componentPtr = componentInfo.mConstruct(mSparseSets[typeId]->Add(entityPointer.mIndex));
+            break;
+        case ComponentStorage::eHeap:
+        default:
         {
-            if (token == '0')
+            auto& components = mHeapComponents[typeId];
+            if (entityPointer.mIndex >= components.size())
             {
-                break;
-            }
-            else if (token == '{')
-            {
-                entityPointer = std::make_unique<Entity>(this);
-                is.read(reinterpret_cast<char*>(&entityPointer->mIndex), sizeof(entityPointer->mIndex));
-                is.read(reinterpret_cast<char*>(&entityPointer->mVersion), sizeof(entityPointer->mVersion));
-                for (auto i = mNextIndex; i < entityPointer->mIndex; i++)
-                {
-                    mFreeIndexes.emplace_back(i);
-                }
-                mNextIndex = static_cast<Entity::PointerSize>(entityPointer->mIndex + 1);
-                mVersions.resize(mNextIndex);
-                mEntityComponents.resize(mNextIndex);
-                mVersions[entityPointer->mIndex] = entityPointer->mVersion;
-                state = ParsingState::eComponentName;
+                components.resize(mVersions.size());
             }
+            auto memory = mComponentPools[typeId]->Allocate();
+            componentPtr = componentInfo.mConstruct(memory);
+            components[entityPointer.mIndex] = memory;
+            break;
         }
-        else if (state == ParsingState::eComponentName)
+    }
+    mSignatures[entityPointer.mIndex].set(typeId);
+    mChangedComponents[typeId].Set(entityPointer.mIndex);
+    UpdateQueries(entityPointer.mIndex);
+    return componentPtr;
+}
+
+void EntityManager::EntityRemoveStoredComponent(const Entity& entityPointer, ComponentTypeId typeId)
+{
+    RequireComponents(ComponentMask{}.set(typeId));
+    switch (mComponentInfos[typeId].mStorage)
+    {
+        case ComponentStorage::eArchetype:
+            EntityRemoveArchetypeComponent(entityPointer, typeId);
+            break;
+        case ComponentStorage::eSparseSet:
+            mSparseSets[typeId]->Remove(entityPointer.mIndex);
+            break;
+        case ComponentStorage::eHeap:
+        default:
+            EntityReleaseHeapComponent(entityPointer.mIndex, typeId);
+            break;
+    }
+    mSignatures[entityPointer.mIndex].reset(typeId);
+    mChangedComponents[typeId].Set(entityPointer.mIndex);
+    UpdateQueries(entityPointer.mIndex);
+}
+
+void EntityManager::EntityReleaseHeapComponent(Entity::PointerSize index, ComponentTypeId typeId)
+{
+    auto& memory = mHeapComponents[typeId][index];
+    mComponentInfos[typeId].mDestroy(memory);
+    mComponentPools[typeId]->Free(memory);
+    memory = nullptr;
+}
+
+void EntityManager::ClearHeapComponents()
+{
+    for (ComponentTypeId typeId = 0; typeId < mHeapComponents.size(); typeId++)
+    {
+        for (auto memory : mHeapComponents[typeId])
         {
-            if (token == '}')
+            if (memory != nullptr)
             {
-                entityPointer->ResolveComponentDependencies();
-                state = ParsingState::eEntity;
+                mComponentInfos[typeId].mDestroy(memory);
             }
-            else if (token == '\0')
+        }
+        mHeapComponents[typeId].clear();
+        if (mComponentPools[typeId] != nullptr)
+        {
+            mComponentPools[typeId]->Clear();
+        }
+    }
+}
+
+EntityQuery* EntityManager::GetOrCreateQuery(const ComponentMask& componentMask)
+{
+    std::lock_guard<std::mutex> lock(mQueriesMutex);
+    auto found = mQueriesByComponents.find(componentMask);
+    if (found != mQueriesByComponents.end())
+    {
+        return found->second;
+    }
+    mQueries.emplace_back(std::make_unique<EntityQuery>(componentMask));
+    auto query = mQueries.back().get();
+    for (auto index = FindAliveIndex(0); index < mVersions.size(); index = FindAliveIndex(index + 1))
+    {
+        query->Update(static_cast<Entity::PointerSize>(index), mSignatures[index]);
+    }
+    return mQueriesByComponents[componentMask] = query;
+}
+
+void EntityManager::UpdateQueries(Entity::PointerSize index)
+{
+    for (auto& query : mQueries)
+    {
+        query->Update(index, mSignatures[index]);
+    }
+}
+
+Archetype* EntityManager::GetOrCreateArchetype(const ComponentMask& componentMask)
+{
+    auto found = mArchetypesByComponents.find(componentMask);
+    if (found != mArchetypesByComponents.end())
+    {
+        return found->second;
+    }
+    std::vector<ComponentInfo> componentInfos;
+    for (ComponentTypeId typeId = 0; typeId < mComponentInfos.size(); typeId++)
+    {
+        if (componentMask[typeId])
+        {
+            componentInfos.emplace_back(mComponentInfos[typeId]);
+        }
+    }
+    mArchetypes.emplace_back(std::make_unique<Archetype>(componentMask, std::move(componentInfos)));
+    return mArchetypesByComponents[componentMask] = mArchetypes.back().get();
+}
+
+Component* EntityManager::EntityAddArchetypeComponent(const Entity& entityPointer, ComponentTypeId typeId)
+{
+    auto source = mEntityLocations[entityPointer.mIndex].mArchetype;
+    auto componentMask = source != nullptr ? source->GetComponentMask() : ComponentMask{};
+    auto destination = GetOrCreateArchetype(componentMask.set(typeId));
+    EntityMoveArchetype(entityPointer.mIndex, destination, -1);
+    const auto& location = mEntityLocations[entityPointer.mIndex];
+    auto column = static_cast<std::size_t>(destination->FindColumn(typeId));
+    return destination->GetComponentInfo(column).mConstruct(destination->GetComponent(location.mRow, column));
+}
+
+void EntityManager::EntityRemoveArchetypeComponent(const Entity& entityPointer, ComponentTypeId typeId)
+{
+    auto source = mEntityLocations[entityPointer.mIndex].mArchetype;
+    auto componentMask = source->GetComponentMask();
+    componentMask.reset(typeId);
+    EntityMoveArchetype(entityPointer.mIndex, componentMask.none() ? nullptr : GetOrCreateArchetype(componentMask), source->FindColumn(typeId));
+}
+
+void EntityManager::EntityMoveArchetype(Entity::PointerSize index, Archetype* destination, std::ptrdiff_t skippedColumn)
+{
+    auto& location = mEntityLocations[index];
+    auto source = location.mArchetype;
+    std::size_t row = 0;
+    if (destination != nullptr)
+    {
+        row = destination->AddRow(index);
+    }
+    if (source != nullptr)
+    {
+        for (std::size_t column = 0; column < source->GetColumnCount(); column++)
+        {
+            const auto& componentInfo = source->GetComponentInfo(column);
+            if (static_cast<std::ptrdiff_t>(column) == skippedColumn)
             {
-                auto componentCreator = mRegisteredComponents.find(componentName);
-                if (componentCreator == mRegisteredComponents.end())
-                {
-                    throw std::logic_error(componentName + std::string { " is not registered" });
-                }
-                auto component = componentCreator->second();
-                auto componentPtr = component.get();
-                mEntityComponents[entityPointer->mIndex].emplace_back(std::move(component));
-                componentPtr->Deserialize(is);
-                EntityConstructComponent(componentPtr, *(entityPointer.get()));
-                componentName.clear();
-                state = ParsingState::eComponentName;
+                componentInfo.mDestroy(source->GetComponent(location.mRow, column));
             }
             else
             {
-                componentName += token;
+                auto destinationColumn = static_cast<std::size_t>(destination->FindColumn(componentInfo.mTypeId));
+                componentInfo.mRelocate(destination->GetComponent(row, destinationColumn), source->GetComponent(location.mRow, column));
             }
         }
+        EntityReleaseArchetypeRow(index);
     }
+    location.mArchetype = destination;
+    location.mRow = row;
 }
 
-bool EntityManager::IsEntityPointerValid(const Entity& entityPointer) const
+void EntityManager::EntityReleaseArchetypeRow(Entity::PointerSize index)
 {
-    return entityPointer.mIndex < mVersions.size() && mVersions[entityPointer.mIndex] == entityPointer.mVersion;
+    auto& location = mEntityLocations[index];
+    Entity::PointerSize movedIndex;
+    if (location.mArchetype->RemoveRow(location.mRow, movedIndex))
+    {
+        mEntityLocations[movedIndex].mRow = location.mRow;
+    }
+    location.mArchetype = nullptr;
+    location.mRow = 0;
 }
 
-void EntityManager::AssertEntityPointerValid(const Entity& entityPointer) const
+void EntityManager::RegisterComponent(ComponentInfo info)
 {
-    if (!IsEntityPointerValid(entityPointer))
+    if (IsComponentRegistered(info.mTypeId))
     {
-        std::stringstream errorFormat;
-        errorFormat << "Entity invalid: " << entityPointer.mIndex << "(" << entityPointer.mIndex << ")";
-        throw std::logic_error(errorFormat.str());
+        if (mComponentInfos[info.mTypeId].mStorage != info.mStorage)
+        {
+            throw std::logic_error(std::string{ "EntityManager::RegisterComponent: Component " } + info.mName + std::string{ " already registered with another storage" });
+        }
+        return;
+    }
+    if (info.mTypeId >= mComponentInfos.size())
+    {
+        mComponentInfos.resize(info.mTypeId + 1);
+        mHeapComponents.resize(info.mTypeId + 1);
+        mSparseSets.resize(info.mTypeId + 1);
+        mComponentPools.resize(info.mTypeId + 1);
+        mChangedComponents.resize(info.mTypeId + 1);
+    }
+    mChangedComponents[info.mTypeId].Resize(mChangedEntities.Size());
+    mRegisteredComponents[info.mName] = info.mTypeId;
+    mArchetypeComponents.set(info.mTypeId, info.mStorage == ComponentStorage::eArchetype);
+    mSparseSetComponents.set(info.mTypeId, info.mStorage == ComponentStorage::eSparseSet);
+    if (info.mStorage == ComponentStorage::eSparseSet)
+    {
+        mSparseSets[info.mTypeId] = std::make_unique<ComponentSparseSet>(info);
     }
+    else if (info.mStorage == ComponentStorage::eHeap)
+    {
+        mComponentPools[info.mTypeId] = std::make_unique<ComponentPool>(info);
+        mComponentPools[info.mTypeId]->SetArena(mComponentArena);
+    }
+    mComponentInfos[info.mTypeId] = std::move(info);
 }
 
-void EntityManager::EntityConstructComponent(Component* component, const Entity& entityPointer)
+void EntityManager::SetComponentArena(ComponentArena* arena)
 {
-    AssertEntityPointerValid(entityPointer);
-    component->mEntity = entityPointer;
-    component->OnLoad();
+    mComponentArena = arena;
+    for (auto& pool : mComponentPools)
+    {
+        if (pool != nullptr)
+        {
+            pool->SetArena(arena);
+        }
+    }
 }
 
-void EntityManager::EntityResolveComponentDependencies(const Entity& entityPointer)
+void EntityManager::SetWorkerThreadCount(std::size_t threadCount)
 {
-    AssertEntityPointerValid(entityPointer);
-    auto& components = mEntityComponents[entityPointer.mIndex];
-    for (auto& component : components)
+    if (threadCount == 0)
     {
-        component->OnResolveDependencies();
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    mJobSystem = std::make_unique<JobSystem>(threadCount);
+}
+
+void EntityManager::SetParallelSnapshotLoad(bool parallel)
+{
+    mParallelSnapshotLoad = parallel;
+}
+
+JobSystem& EntityManager::GetJobSystem()
+{
+    if (mJobSystem == nullptr)
+    {
+        SetWorkerThreadCount(0);
     }
+    return *mJobSystem;
+}
+
+bool EntityManager::IsComponentRegistered(ComponentTypeId typeId) const
+{
+    return typeId < mComponentInfos.size() && mComponentInfos[typeId].mCreate != nullptr;
 }
 
 #if defined(_DEBUG)
@@ -185,7 +1532,7 @@ EntityManager::Iterator EntityManager::begin()
 
 EntityManager::Iterator EntityManager::end()
 {
-    return { *this, static_cast<Entity::PointerSize>(mEntityComponents.size()) };
+    return { *this, static_cast<Entity::PointerSize>(mVersions.size()) };
 }
 
 EntityManager::ConstIterator EntityManager::begin() const
@@ -195,7 +1542,7 @@ EntityManager::ConstIterator EntityManager::begin() const
 
 EntityManager::ConstIterator EntityManager::end() const
 {
-    return { *this, static_cast<Entity::PointerSize>(mEntityComponents.size()) };
+    return { *this, static_cast<Entity::PointerSize>(mVersions.size()) };
 }
 
 void EntityManager::Clear()
@@ -203,10 +1550,229 @@ void EntityManager::Clear()
     mNextIndex = 0;
     mVersions.clear();
     mFreeIndexes.clear();
-    mEntityComponents.clear();
+    mSignatures.clear();
+    mAliveEntities.clear();
+    mAliveCount = 0;
+    for (auto& query : mQueries)
+    {
+        query->Clear();
+    }
+    ClearHeapComponents();
+    for (auto& sparseSet : mSparseSets)
+    {
+        if (sparseSet != nullptr)
+        {
+            sparseSet->Clear();
+        }
+    }
+    mEntityLocations.clear();
+    mArchetypesByComponents.clear();
+    mArchetypes.clear();
+    mSnapshotComponents.reset();
+    mSnapshotBlocks.clear();
+    mSnapshotReader.reset();
+    ClearChanges();
 }
 
 std::size_t EntityManager::Size() const
 {
-    return mEntityComponents.size() - mFreeIndexes.size();
+    return mAliveCount;
+}
+
+std::size_t EntityManager::Capacity() const
+{
+    return std::min({ mVersions.capacity(), mSignatures.capacity(), mEntityLocations.capacity() });
+}
+
+void EntityManager::Reserve(std::size_t entityCount)
+{
+    mVersions.reserve(entityCount);
+    mSignatures.reserve(entityCount);
+    mEntityLocations.reserve(entityCount);
+    mAliveEntities.reserve((entityCount + 63u) / 64u);
+    for (ComponentTypeId typeId = 0; typeId < mHeapComponents.size(); typeId++)
+    {
+        if (mComponentPools[typeId] != nullptr)
+        {
+            mHeapComponents[typeId].reserve(entityCount);
+        }
+    }
+}
+
+void EntityManager::ReserveComponents(ComponentTypeId typeId, std::size_t componentCount)
+{
+    if (mSparseSetComponents[typeId])
+    {
+        mSparseSets[typeId]->Reserve(componentCount);
+    }
+    else if (!mArchetypeComponents[typeId])
+    {
+        mComponentPools[typeId]->Reserve(componentCount);
+    }
+}
+
+std::size_t EntityManager::GetComponentCapacity(ComponentTypeId typeId) const
+{
+    if (!IsComponentRegistered(typeId))
+    {
+        return 0;
+    }
+    if (mSparseSetComponents[typeId])
+    {
+        return mSparseSets[typeId]->GetCapacity();
+    }
+    if (mArchetypeComponents[typeId])
+    {
+        std::size_t capacity = 0;
+        for (const auto& archetype : mArchetypes)
+        {
+            if (archetype->GetComponentMask()[typeId])
+            {
+                capacity += archetype->GetChunkCount() * archetype->GetChunkCapacity();
+            }
+        }
+        return capacity;
+    }
+    return mComponentPools[typeId]->GetCapacity();
+}
+
+void EntityManager::ShrinkToFit()
+{
+    // a trimmed slot may be handed out again later, new slots start above its version so its stale handles stay invalid
+    // a retired slot stops the trim since its version cannot grow any further
+    auto size = mVersions.size();
+    while (size > 0 && FindAliveIndex(size - 1) != size - 1 && mVersions[size - 1] != Entity::MaxVersion)
+    {
+        mFirstVersion = std::max(mFirstVersion, mVersions[size - 1]);
+        size -= 1;
+    }
+    mNextIndex = static_cast<Entity::PointerSize>(size);
+    mFreeIndexes.erase(std::remove_if(mFreeIndexes.begin(), mFreeIndexes.end(), [size](Entity::PointerSize index)
+    {
+        return index >= size;
+    }), mFreeIndexes.end());
+    mFreeIndexes.shrink_to_fit();
+    mVersions.resize(size);
+    mVersions.shrink_to_fit();
+    mSignatures.resize(size);
+    mSignatures.shrink_to_fit();
+    mEntityLocations.resize(size);
+    mEntityLocations.shrink_to_fit();
+    mAliveEntities.resize((size + 63u) / 64u);
+    mAliveEntities.shrink_to_fit();
+
+    for (ComponentTypeId typeId = 0; typeId < mHeapComponents.size(); typeId++)
+    {
+        auto& components = mHeapComponents[typeId];
+        if (components.size() > size)
+        {
+            components.resize(size);
+        }
+        components.shrink_to_fit();
+        if (mComponentPools[typeId] != nullptr)
+        {
+            mComponentPools[typeId]->ShrinkToFit();
+        }
+    }
+    for (auto& sparseSet : mSparseSets)
+    {
+        if (sparseSet != nullptr)
+        {
+            sparseSet->ShrinkToFit(size);
+        }
+    }
+    for (auto& archetype : mArchetypes)
+    {
+        archetype->ShrinkToFit();
+    }
+    for (auto& query : mQueries)
+    {
+        query->ShrinkToFit(size);
+    }
+}
+
+MemoryStats EntityManager::GetMemoryStats() const
+{
+    MemoryStats stats;
+    GetMemoryStats(stats);
+    return stats;
+}
+
+void EntityManager::GetMemoryStats(MemoryStats& stats) const
+{
+    std::size_t registeredCount = 0;
+    for (ComponentTypeId typeId = 0; typeId < mComponentInfos.size(); typeId++)
+    {
+        registeredCount += IsComponentRegistered(typeId) ? 1 : 0;
+    }
+    stats.mComponents.resize(registeredCount);
+    auto component = stats.mComponents.begin();
+    for (ComponentTypeId typeId = 0; typeId < mComponentInfos.size(); typeId++)
+    {
+        if (!IsComponentRegistered(typeId))
+        {
+            continue;
+        }
+        const auto& componentInfo = mComponentInfos[typeId];
+        component->mName = componentInfo.mName;
+        component->mTypeId = typeId;
+        component->mStorage = componentInfo.mStorage;
+        if (mSparseSetComponents[typeId])
+        {
+            component->mCount = mSparseSets[typeId]->Size();
+            component->mCapacity = mSparseSets[typeId]->GetCapacity();
+            component->mByteSize = mSparseSets[typeId]->GetByteSize();
+        }
+        else if (mArchetypeComponents[typeId])
+        {
+            component->mCount = 0;
+            component->mCapacity = 0;
+            for (const auto& archetype : mArchetypes)
+            {
+                if (archetype->GetComponentMask()[typeId])
+                {
+                    component->mCount += archetype->Size();
+                    component->mCapacity += archetype->GetChunkCount() * archetype->GetChunkCapacity();
+                }
+            }
+            component->mByteSize = componentInfo.mSize * component->mCapacity;
+        }
+        else
+        {
+            component->mCount = mComponentPools[typeId]->Size();
+            component->mCapacity = mComponentPools[typeId]->GetCapacity();
+            component->mByteSize = mComponentPools[typeId]->GetByteSize() + sizeof(void*) * mHeapComponents[typeId].capacity();
+        }
+        component->mUsedByteSize = componentInfo.mSize * component->mCount;
+        ++component;
+    }
+
+    stats.mEntityCount = Size();
+    stats.mEntitySlotCount = mVersions.size();
+    stats.mEntityByteSize = sizeof(Entity::PointerSize) * mVersions.capacity() + sizeof(ComponentMask) * mSignatures.capacity() + sizeof(EntityLocation) * mEntityLocations.capacity() + sizeof(std::uint64_t) * mAliveEntities.capacity();
+    stats.mFreeIndexCount = mFreeIndexes.size();
+    stats.mFreeIndexByteSize = sizeof(Entity::PointerSize) * mFreeIndexes.capacity();
+    stats.mArchetypeCount = mArchetypes.size();
+    stats.mArchetypeByteSize = 0;
+    for (const auto& archetype : mArchetypes)
+    {
+        stats.mArchetypeByteSize += archetype->GetByteSize();
+    }
+    stats.mQueryCount = mQueries.size();
+    stats.mQueryByteSize = 0;
+    for (const auto& query : mQueries)
+    {
+        stats.mQueryByteSize += query->GetByteSize();
+    }
+    stats.mSystemCount = mSystems.size();
+    stats.mSystemByteSize = sizeof(std::unique_ptr<System>) * mSystems.capacity() + sizeof(System*) * mSystemsByType.capacity();
+    for (const auto& system : mSystems)
+    {
+        stats.mSystemByteSize += system->mByteSize;
+    }
+    stats.mChangeSetByteSize = mChangedEntities.GetByteSize();
+    for (const auto& changedComponents : mChangedComponents)
+    {
+        stats.mChangeSetByteSize += changedComponents.GetByteSize();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include "core/entityquery.hpp"
+
+constexpr std::uint32_t EntityQuery::InvalidPosition;
+
+EntityQuery::EntityQuery(const ComponentMask& componentMask) : mComponentMask(componentMask)
+{
+
+}
+
+const ComponentMask& EntityQuery::GetComponentMask() const
+{
+    return mComponentMask;
+}
+
+std::size_t EntityQuery::Size() const
+{
+    return mEntities.size();
+}
+
+const Entity::PointerSize* EntityQuery::GetEntities() const
+{
+    return mEntities.data();
+}
+
+bool EntityQuery::Contains(Entity::PointerSize index) const
+{
+    return index < mPositions.size() && mPositions[index] != InvalidPosition;
+}
+
+std::size_t EntityQuery::GetByteSize() const
+{
+    return sizeof(Entity::PointerSize) * mEntities.capacity() + sizeof(std::uint32_t) * mPositions.capacity();
+}
+
+void EntityQuery::Update(Entity::PointerSize index, const ComponentMask& signature)
+{
+    const auto matches = (signature & mComponentMask) == mComponentMask;
+    if (matches && !Contains(index))
+    {
+        Add(index);
+    }
+    else if (!matches && Contains(index))
+    {
+        Remove(index);
+    }
+}
+
+void EntityQuery::Add(Entity::PointerSize index)
+{
+    if (index >= mPositions.size())
+    {
+        mPositions.resize(index + 1u, InvalidPosition);
+    }
+    mPositions[index] = static_cast<std::uint32_t>(mEntities.size());
+    mEntities.emplace_back(index);
+}
+
+void EntityQuery::Remove(Entity::PointerSize index)
+{
+    if (!Contains(index))
+    {
+        return;
+    }
+    const auto position = mPositions[index];
+    mEntities[position] = mEntities.back();
+    mPositions[mEntities[position]] = position;
+    mEntities.pop_back();
+    mPositions[index] = InvalidPosition;
+}
+
+void EntityQuery::Clear()
+{
+    mEntities.clear();
+    mPositions.clear();
+}
+
+void EntityQuery::ShrinkToFit(std::size_t entityCount)
+{
+    mEntities.shrink_to_fit();
+    if (mPositions.size() > entityCount)
+    {
+        mPositions.resize(entityCount);
+    }
+    mPositions.shrink_to_fit();
+}
@@ -0,0 +1,261 @@
+#include <utility>
+#include <algorithm>
+
+#include "core/jobsystem.hpp"
+
+namespace
+{
+    // queue owned by the current thread, only meaningful for the system that spawned it
+    thread_local const JobSystem* tJobSystem = nullptr;
+    thread_local std::size_t tQueueIndex = 0;
+}
+
+bool JobHandle::IsDone() const
+{
+    return mState == nullptr || mState->mPendingJobs.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem(std::size_t threadCount)
+{
+    threadCount = std::max<std::size_t>(1, threadCount);
+    for (std::size_t i = 0; i < threadCount; i++)
+    {
+        mQueues.emplace_back(std::make_unique<JobQueue>());
+    }
+    for (std::size_t i = 1; i < threadCount; i++)
+    {
+        mThreads.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mStopping = true;
+    }
+    mWakeUp.notify_all();
+    for (auto& thread : mThreads)
+    {
+        thread.join();
+    }
+    // without workers, or when a late continuation was pushed after they left, nothing else would run these
+    while (TryRun())
+    {
+    }
+}
+
+std::size_t JobSystem::GetThreadCount() const
+{
+    return mQueues.size();
+}
+
+JobHandle JobSystem::Schedule(std::function<void()> job)
+{
+    JobHandle handle;
+    handle.mState = std::make_shared<JobHandle::State>();
+    handle.mState->mPendingJobs = 1;
+    Push({ std::move(job), handle.mState });
+    return handle;
+}
+
+JobHandle JobSystem::Schedule(std::function<void()> job, const std::vector<JobHandle>& dependencies)
+{
+    JobHandle handle;
+    handle.mState = std::make_shared<JobHandle::State>();
+    handle.mState->mPendingJobs = 1;
+    auto continuation = std::make_shared<JobContinuation>();
+    continuation->mJob = { std::move(job), handle.mState };
+    // one extra dependency keeps the job from being queued while the others are being registered
+    continuation->mDependencies = dependencies.size() + 1;
+    auto resolved = std::size_t{ 1 };
+    for (const auto& dependency : dependencies)
+    {
+        if (dependency.mState == nullptr)
+        {
+            resolved += 1;
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(dependency.mState->mMutex);
+        if (dependency.mState->mPendingJobs.load(std::memory_order_acquire) == 0)
+        {
+            resolved += 1;
+        }
+        else
+        {
+            dependency.mState->mContinuations.emplace_back(continuation);
+        }
+    }
+    if (continuation->mDependencies.fetch_sub(resolved, std::memory_order_acq_rel) == resolved)
+    {
+        Push(std::move(continuation->mJob));
+    }
+    return handle;
+}
+
+JobHandle JobSystem::ScheduleParallelFor(std::size_t count, std::size_t grainSize, std::function<void(std::size_t begin, std::size_t end)> job)
+{
+    JobHandle handle;
+    if (count == 0)
+    {
+        return handle;
+    }
+    handle.mState = std::make_shared<JobHandle::State>();
+    handle.mState->mPendingJobs = 1;
+    auto sharedJob = std::make_shared<std::function<void(std::size_t, std::size_t)>>(std::move(job));
+    auto state = handle.mState;
+    grainSize = std::max<std::size_t>(1, grainSize);
+    Push({ [this, state, sharedJob, count, grainSize]
+           {
+               SplitRange(state, sharedJob, 0, count, grainSize);
+           }, handle.mState });
+    return handle;
+}
+
+void JobSystem::Wait(const JobHandle& handle)
+{
+    while (!handle.IsDone())
+    {
+        if (!TryRun())
+        {
+            std::this_thread::yield();
+        }
+    }
+    if (handle.mState != nullptr && handle.mState->mException != nullptr)
+    {
+        std::rethrow_exception(handle.mState->mException);
+    }
+}
+
+void JobSystem::ParallelFor(std::size_t count, std::size_t grainSize, std::function<void(std::size_t begin, std::size_t end)> job)
+{
+    Wait(ScheduleParallelFor(count, grainSize, std::move(job)));
+}
+
+void JobSystem::Push(Job job)
+{
+    auto& queue = *mQueues[GetQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mMutex);
+        queue.mJobs.emplace_back(std::move(job));
+    }
+    mQueuedJobs.fetch_add(1, std::memory_order_release);
+    {
+        // taking the lock orders the push with a worker about to sleep, so the wake up is never lost
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+    }
+    mWakeUp.notify_one();
+}
+
+bool JobSystem::TryRun()
+{
+    const auto own = GetQueueIndex();
+    Job job;
+    auto found = TryPop(own, false, job);
+    for (std::size_t i = 1; !found && i < mQueues.size(); i++)
+    {
+        found = TryPop((own + i) % mQueues.size(), true, job);
+    }
+    if (!found)
+    {
+        return false;
+    }
+    try
+    {
+        job.mFunction();
+    }
+    catch (...)
+    {
+        if (!job.mState->mFailed.exchange(true))
+        {
+            job.mState->mException = std::current_exception();
+        }
+    }
+    Complete(*job.mState);
+    return true;
+}
+
+void JobSystem::Complete(JobHandle::State& state)
+{
+    if (state.mPendingJobs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+    std::vector<std::shared_ptr<JobContinuation>> continuations;
+    {
+        // Schedule registers continuations under the same lock only while the handle is not done
+        std::lock_guard<std::mutex> lock(state.mMutex);
+        continuations.swap(state.mContinuations);
+    }
+    for (auto& continuation : continuations)
+    {
+        if (continuation->mDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            Push(std::move(continuation->mJob));
+        }
+    }
+}
+
+bool JobSystem::TryPop(std::size_t queue, bool steal, Job& job)
+{
+    auto& jobQueue = *mQueues[queue];
+    std::lock_guard<std::mutex> lock(jobQueue.mMutex);
+    if (jobQueue.mJobs.empty())
+    {
+        return false;
+    }
+    if (steal)
+    {
+        job = std::move(jobQueue.mJobs.front());
+        jobQueue.mJobs.pop_front();
+    }
+    else
+    {
+        job = std::move(jobQueue.mJobs.back());
+        jobQueue.mJobs.pop_back();
+    }
+    mQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::size_t JobSystem::GetQueueIndex() const
+{
+    return tJobSystem == this ? tQueueIndex : 0;
+}
+
+void JobSystem::WorkerLoop(std::size_t queue)
+{
+    tJobSystem = this;
+    tQueueIndex = queue;
+    while (true)
+    {
+        if (TryRun())
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mSleepMutex);
+        mWakeUp.wait(lock, [this] { return mStopping || mQueuedJobs.load(std::memory_order_acquire) > 0; });
+        if (mStopping)
+        {
+            return;
+        }
+    }
+}
+
+void JobSystem::SplitRange(const std::shared_ptr<JobHandle::State>& state, std::shared_ptr<std::function<void(std::size_t, std::size_t)>> job, std::size_t begin, std::size_t end, std::size_t grainSize)
+{
+    while (end - begin > grainSize && !state->mFailed.load(std::memory_order_relaxed))
+    {
+        const auto middle = begin + (end - begin) / 2;
+        state->mPendingJobs.fetch_add(1, std::memory_order_relaxed);
+        Push({ [this, state, job, middle, end, grainSize]
+               {
+                   SplitRange(state, job, middle, end, grainSize);
+               }, state });
+        end = middle;
+    }
+    if (!state->mFailed.load(std::memory_order_relaxed))
+    {
+        (*job)(begin, end);
+    }
+}
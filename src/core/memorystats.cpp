@@ -0,0 +1,44 @@
+#include "core/memorystats.hpp"
+
+std::size_t MemoryStats::GetByteSize() const
+{
+    auto byteSize = mEntityByteSize + mFreeIndexByteSize + mArchetypeByteSize + mQueryByteSize + mSystemByteSize + mChangeSetByteSize;
+    for (const auto& component : mComponents)
+    {
+        if (component.mStorage != ComponentStorage::eArchetype)
+        {
+            byteSize += component.mByteSize;
+        }
+    }
+    return byteSize;
+}
+
+std::size_t MemoryStats::GetComponentByteSize() const
+{
+    std::size_t byteSize = 0;
+    for (const auto& component : mComponents)
+    {
+        byteSize += component.mByteSize;
+    }
+    return byteSize;
+}
+
+std::size_t MemoryStats::GetComponentUsedByteSize() const
+{
+    std::size_t usedByteSize = 0;
+    for (const auto& component : mComponents)
+    {
+        usedByteSize += component.mUsedByteSize;
+    }
+    return usedByteSize;
+}
+
+float MemoryStats::GetFragmentation() const
+{
+    const auto byteSize = GetComponentByteSize();
+    if (byteSize == 0)
+    {
+        return 0.0f;
+    }
+    return 1.0f - static_cast<float>(GetComponentUsedByteSize()) / static_cast<float>(byteSize);
+}
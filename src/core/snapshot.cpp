@@ -0,0 +1,178 @@
+#include <cstring>
+#include <algorithm>
+#include <istream>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   define ALIVE_ECS_MMAP 1
+#endif
+
+#include "core/snapshot.hpp"
+
+ComponentCopies::ComponentCopies(const ComponentInfo& componentInfo, std::size_t capacity) : mComponentInfo(componentInfo), mData(new unsigned char[componentInfo.mSize * capacity])
+{
+    mComponents.reserve(capacity);
+}
+
+ComponentCopies::~ComponentCopies()
+{
+    for (std::size_t position = 0; position < mComponents.size(); position++)
+    {
+        mComponentInfo.mDestroy(mData.get() + mComponentInfo.mSize * position);
+    }
+}
+
+void ComponentCopies::Add(const Component* component)
+{
+    if (mComponents.size() == mComponents.capacity())
+    {
+        throw std::logic_error("ComponentCopies::Add: Capacity exceeded");
+    }
+    mComponents.emplace_back(mComponentInfo.mCopy(mData.get() + mComponentInfo.mSize * mComponents.size(), component));
+}
+
+std::size_t ComponentCopies::Size() const
+{
+    return mComponents.size();
+}
+
+Component* ComponentCopies::Get(std::size_t position) const
+{
+    return mComponents[position];
+}
+
+SnapshotStreamReader::SnapshotStreamReader(std::istream& is) : mStream(is)
+{
+
+}
+
+void SnapshotStreamReader::Read(void* data, std::size_t byteSize)
+{
+    if (byteSize != 0 && !mStream.read(static_cast<char*>(data), static_cast<std::streamsize>(byteSize)))
+    {
+        throw std::logic_error("SnapshotReader: Truncated snapshot");
+    }
+}
+
+const char* SnapshotStreamReader::ReadBlock(std::size_t byteSize)
+{
+    // read in chunks, a corrupted size fails on the missing bytes instead of allocating them all up front
+    static constexpr std::size_t ChunkByteSize = 1024 * 1024;
+    mBlocks.emplace_back();
+    auto& block = mBlocks.back();
+    while (block.size() < byteSize)
+    {
+        const auto offset = block.size();
+        block.resize(offset + std::min(ChunkByteSize, byteSize - offset));
+        Read(&block[offset], block.size() - offset);
+    }
+    return block.data();
+}
+
+SnapshotBuffer::SnapshotBuffer(std::unique_ptr<char[]> data, std::size_t byteSize) : mData(std::move(data)), mByteSize(byteSize)
+{
+
+}
+
+void SnapshotBuffer::Read(void* data, std::size_t byteSize)
+{
+    auto block = ReadBlock(byteSize);
+    if (byteSize != 0)
+    {
+        std::memcpy(data, block, byteSize);
+    }
+}
+
+const char* SnapshotBuffer::ReadBlock(std::size_t byteSize)
+{
+    if (byteSize > mByteSize - mOffset)
+    {
+        throw std::logic_error("SnapshotReader: Truncated snapshot");
+    }
+    auto block = mData.get() + mOffset;
+    mOffset += byteSize;
+    return block;
+}
+
+SnapshotFile::SnapshotFile(const std::string& path)
+{
+#if defined(ALIVE_ECS_MMAP)
+    const auto file = open(path.c_str(), O_RDONLY);
+    if (file == -1)
+    {
+        throw std::logic_error(std::string{ "SnapshotFile: Cannot open " } + path);
+    }
+    struct stat status = {};
+    if (fstat(file, &status) == -1)
+    {
+        close(file);
+        throw std::logic_error(std::string{ "SnapshotFile: Cannot open " } + path);
+    }
+    mByteSize = static_cast<std::size_t>(status.st_size);
+    if (mByteSize != 0)
+    {
+        auto data = mmap(nullptr, mByteSize, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED)
+        {
+            close(file);
+            throw std::logic_error(std::string{ "SnapshotFile: Cannot map " } + path);
+        }
+        mData = static_cast<const char*>(data);
+    }
+    close(file);
+#else
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        throw std::logic_error(std::string{ "SnapshotFile: Cannot open " } + path);
+    }
+    mByteSize = static_cast<std::size_t>(file.tellg());
+    mBuffer.reset(new char[mByteSize]);
+    file.seekg(0);
+    if (!file.read(mBuffer.get(), static_cast<std::streamsize>(mByteSize)))
+    {
+        throw std::logic_error(std::string{ "SnapshotFile: Cannot read " } + path);
+    }
+    mData = mBuffer.get();
+#endif
+}
+
+SnapshotFile::~SnapshotFile()
+{
+#if defined(ALIVE_ECS_MMAP)
+    if (mData != nullptr)
+    {
+        munmap(const_cast<char*>(mData), mByteSize);
+    }
+#endif
+}
+
+std::size_t SnapshotFile::GetByteSize() const
+{
+    return mByteSize;
+}
+
+void SnapshotFile::Read(void* data, std::size_t byteSize)
+{
+    auto block = ReadBlock(byteSize);
+    if (byteSize != 0)
+    {
+        std::memcpy(data, block, byteSize);
+    }
+}
+
+const char* SnapshotFile::ReadBlock(std::size_t byteSize)
+{
+    if (byteSize > mByteSize - mOffset)
+    {
+        throw std::logic_error("SnapshotReader: Truncated snapshot");
+    }
+    auto block = mData + mOffset;
+    mOffset += byteSize;
+    return block;
+}
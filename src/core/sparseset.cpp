@@ -0,0 +1,132 @@
+#include <string>
+#include <utility>
+#include <stdexcept>
+
+#include "core/sparseset.hpp"
+
+constexpr std::uint32_t ComponentSparseSet::InvalidPosition;
+
+ComponentSparseSet::ComponentSparseSet(ComponentInfo componentInfo) : mComponentInfo(std::move(componentInfo))
+{
+    if (mComponentInfo.mAlignment > alignof(std::max_align_t))
+    {
+        throw std::logic_error(std::string{ "ComponentSparseSet: Component " } + mComponentInfo.mName + std::string{ " is over-aligned" });
+    }
+}
+
+ComponentSparseSet::~ComponentSparseSet()
+{
+    Clear();
+}
+
+const ComponentInfo& ComponentSparseSet::GetComponentInfo() const
+{
+    return mComponentInfo;
+}
+
+std::size_t ComponentSparseSet::Size() const
+{
+    return mSize;
+}
+
+std::size_t ComponentSparseSet::GetCapacity() const
+{
+    return mCapacity;
+}
+
+std::size_t ComponentSparseSet::GetByteSize() const
+{
+    return mComponentInfo.mSize * mCapacity + sizeof(Entity::PointerSize) * mEntities.capacity() + sizeof(std::uint32_t) * mPositions.capacity();
+}
+
+const Entity::PointerSize* ComponentSparseSet::GetEntities() const
+{
+    return mEntities.data();
+}
+
+unsigned char* ComponentSparseSet::GetComponents() const
+{
+    return mComponents.get();
+}
+
+void* ComponentSparseSet::Add(Entity::PointerSize index)
+{
+    if (mSize == mCapacity)
+    {
+        Grow(mCapacity == 0 ? 64 : mCapacity * 2);
+    }
+    if (index >= mPositions.size())
+    {
+        mPositions.resize(index + 1u, InvalidPosition);
+    }
+    mPositions[index] = static_cast<std::uint32_t>(mSize);
+    mEntities.emplace_back(index);
+    return mComponents.get() + mComponentInfo.mSize * mSize++;
+}
+
+void ComponentSparseSet::Remove(Entity::PointerSize index)
+{
+    const auto position = mPositions[index];
+    const auto last = mSize - 1;
+    mComponentInfo.mDestroy(mComponents.get() + mComponentInfo.mSize * position);
+    if (position != last)
+    {
+        // keeps the dense arrays packed by moving the last component into the hole
+        mComponentInfo.mRelocate(mComponents.get() + mComponentInfo.mSize * position, mComponents.get() + mComponentInfo.mSize * last);
+        mEntities[position] = mEntities[last];
+        mPositions[mEntities[position]] = position;
+    }
+    mEntities.pop_back();
+    mPositions[index] = InvalidPosition;
+    mSize -= 1;
+}
+
+void* ComponentSparseSet::Get(Entity::PointerSize index) const
+{
+    return mComponents.get() + mComponentInfo.mSize * mPositions[index];
+}
+
+void ComponentSparseSet::Clear()
+{
+    for (std::size_t position = 0; position < mSize; position++)
+    {
+        mComponentInfo.mDestroy(mComponents.get() + mComponentInfo.mSize * position);
+    }
+    mSize = 0;
+    mEntities.clear();
+    mPositions.clear();
+}
+
+void ComponentSparseSet::Reserve(std::size_t capacity)
+{
+    if (capacity > mCapacity)
+    {
+        Grow(capacity);
+    }
+    mEntities.reserve(capacity);
+}
+
+void ComponentSparseSet::ShrinkToFit(std::size_t entityCount)
+{
+    if (mCapacity > mSize)
+    {
+        Grow(mSize);
+    }
+    mEntities.shrink_to_fit();
+    if (mPositions.size() > entityCount)
+    {
+        mPositions.resize(entityCount);
+    }
+    mPositions.shrink_to_fit();
+}
+
+void ComponentSparseSet::Grow(std::size_t capacity)
+{
+    std::unique_ptr<unsigned char[]> components(new unsigned char[mComponentInfo.mSize * capacity]);
+    for (std::size_t position = 0; position < mSize; position++)
+    {
+        mComponentInfo.mRelocate(components.get() + mComponentInfo.mSize * position, mComponents.get() + mComponentInfo.mSize * position);
+    }
+    mComponents = std::move(components);
+    mCapacity = capacity;
+}
@@ -1,3 +1,5 @@
+#include <atomic>
+
 #include "core/system.hpp"
 
 DEFINE_ROOT_SYSTEM(System);
@@ -7,6 +9,22 @@ System::~System() // NOLINT
 
 }
 
+SystemTypeId System::NextTypeId()
+{
+    static std::atomic<SystemTypeId> nextTypeId{ 0 };
+    return nextTypeId++;
+}
+
+const ComponentMask& System::GetReadComponents() const
+{
+    return mReadComponents;
+}
+
+const ComponentMask& System::GetWriteComponents() const
+{
+    return mWriteComponents;
+}
+
 void System::OnLoad()
 {
     OnResolveDependencies();
@@ -17,4 +35,17 @@ void System::OnResolveDependencies()
 
 }
 
-#undef DEFINE_ROOT_SYSTEM
\ No newline at end of file
+void System::OnUpdate(float)
+{
+
+}
+
+void System::UpdateAfter(const System* system)
+{
+    if (system != nullptr)
+    {
+        mUpdateAfter.emplace_back(system);
+    }
+}
+
+#undef DEFINE_ROOT_SYSTEM
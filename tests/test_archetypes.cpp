@@ -0,0 +1,144 @@
+#include <sstream>
+#include <gtest/gtest.h>
+
+#include <core/entitymanager.hpp>
+
+#include "test_components/components.hpp"
+
+static std::unique_ptr<EntityManager> CreateArchetypeEntityManager()
+{
+    auto manager = std::make_unique<EntityManager>();
+    manager->RegisterComponent<DummyComponent>();
+    manager->RegisterComponent<PhysicsComponent>(ComponentStorage::eArchetype);
+    manager->RegisterComponent<TransformComponent>(ComponentStorage::eArchetype);
+    return manager;
+}
+
+TEST(Archetypes, AddGetRemoveComponent)
+{
+    auto manager = CreateArchetypeEntityManager();
+    auto entity = manager->CreateEntity();
+    auto transform = entity.AddComponent<TransformComponent>();
+    transform->mData.x = 32.0f;
+    transform->mData.y = 64.0f;
+    EXPECT_EQ(transform, entity.GetComponent<TransformComponent>());
+    EXPECT_ANY_THROW(entity.AddComponent<TransformComponent>());
+
+    // adding a component moves the entity to another archetype, its components follow
+    entity.AddComponent<PhysicsComponent>();
+    entity.AddComponent<DummyComponent>();
+    EXPECT_TRUE((entity.HasComponent<DummyComponent, PhysicsComponent, TransformComponent>()));
+    EXPECT_EQ(32.0f, entity.GetComponent<TransformComponent>()->GetX());
+    EXPECT_EQ(64.0f, entity.GetComponent<TransformComponent>()->GetY());
+
+    entity.RemoveComponent<PhysicsComponent>();
+    EXPECT_FALSE(entity.HasComponent<PhysicsComponent>());
+    EXPECT_EQ(32.0f, entity.GetComponent<TransformComponent>()->GetX());
+    EXPECT_ANY_THROW(entity.RemoveComponent<PhysicsComponent>());
+
+    entity.RemoveComponent<TransformComponent>();
+    EXPECT_EQ(nullptr, entity.GetComponent<TransformComponent>());
+    EXPECT_TRUE(entity.HasComponent<DummyComponent>());
+}
+
+TEST(Archetypes, DestroyKeepsOtherEntitiesIntact)
+{
+    auto manager = CreateArchetypeEntityManager();
+    std::vector<Entity> entities;
+    for (auto i = 0; i < 2000; i++)
+    {
+        auto entity = manager->CreateEntityWith<TransformComponent>();
+        entity.GetComponent<TransformComponent>()->mData.x = static_cast<float>(i);
+        entities.emplace_back(entity);
+    }
+    for (auto i = 0; i < 2000; i += 3)
+    {
+        entities[i].Destroy();
+    }
+    for (auto i = 0; i < 2000; i++)
+    {
+        if (i % 3 == 0)
+        {
+            EXPECT_FALSE(entities[i].IsValid());
+        }
+        else
+        {
+            ASSERT_NE(nullptr, entities[i].GetComponent<TransformComponent>());
+            EXPECT_EQ(static_cast<float>(i), entities[i].GetComponent<TransformComponent>()->GetX());
+        }
+    }
+    EXPECT_EQ(1333, manager->With<TransformComponent>().size());
+}
+
+TEST(Archetypes, WithMixedStorages)
+{
+    auto manager = CreateArchetypeEntityManager();
+    auto entity1 = manager->CreateEntityWith<TransformComponent, PhysicsComponent>();
+    auto entity2 = manager->CreateEntityWith<TransformComponent, DummyComponent>();
+    auto entity3 = manager->CreateEntityWith<TransformComponent, PhysicsComponent, DummyComponent>();
+    manager->CreateEntityWith<DummyComponent>();
+
+    auto count = 0;
+    manager->With<TransformComponent>([&](auto e, auto transform)
+                                      {
+                                          EXPECT_EQ(e.template GetComponent<TransformComponent>(), transform);
+                                          count += 1;
+                                      });
+    EXPECT_EQ(3, count);
+
+    count = 0;
+    manager->With<DummyComponent, TransformComponent>([&](auto e, auto dummy, auto transform)
+                                                      {
+                                                          EXPECT_TRUE(e == entity2 || e == entity3);
+                                                          EXPECT_EQ(e.template GetComponent<DummyComponent>(), dummy);
+                                                          EXPECT_EQ(e.template GetComponent<TransformComponent>(), transform);
+                                                          count += 1;
+                                                      });
+    EXPECT_EQ(2, count);
+
+    auto entities = manager->With<PhysicsComponent, TransformComponent>();
+    ASSERT_EQ(2, entities.size());
+    EXPECT_TRUE((entities[0] == entity1 && entities[1] == entity3) || (entities[0] == entity3 && entities[1] == entity1));
+}
+
+TEST(Archetypes, SaveAndLoad)
+{
+    auto manager = CreateArchetypeEntityManager();
+    auto entity1 = manager->CreateEntityWith<DummyComponent, TransformComponent>();
+    entity1.GetComponent<TransformComponent>()->mData.x = 12.0f;
+    manager->CreateEntity().Destroy();
+    auto entity2 = manager->CreateEntityWith<PhysicsComponent, TransformComponent>();
+    entity2.GetComponent<TransformComponent>()->mData.y = 24.0f;
+
+    std::stringstream stream;
+    manager->Serialize(stream);
+    manager->Deserialize(stream);
+
+    ASSERT_TRUE(entity1.IsValid());
+    ASSERT_TRUE(entity2.IsValid());
+    EXPECT_TRUE((entity1.HasComponent<DummyComponent, TransformComponent>()));
+    EXPECT_TRUE((entity2.HasComponent<PhysicsComponent, TransformComponent>()));
+    EXPECT_EQ(12.0f, entity1.GetComponent<TransformComponent>()->GetX());
+    EXPECT_EQ(24.0f, entity2.GetComponent<TransformComponent>()->GetY());
+}
+
+TEST(Archetypes, CreateEntitiesWith)
+{
+    auto manager = CreateArchetypeEntityManager();
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<DummyComponent, TransformComponent, PhysicsComponent>(3000, entities);
+    for (auto i = 0; i < 3000; i++)
+    {
+        entities[i].GetComponent<TransformComponent>()->mData.x = static_cast<float>(i);
+    }
+    for (auto i = 0; i < 3000; i += 2)
+    {
+        entities[i].RemoveComponent<PhysicsComponent>();
+    }
+    for (auto i = 0; i < 3000; i++)
+    {
+        ASSERT_TRUE((entities[i].HasComponent<DummyComponent, TransformComponent>()));
+        EXPECT_EQ(i % 2 == 1, entities[i].HasComponent<PhysicsComponent>());
+        EXPECT_EQ(static_cast<float>(i), entities[i].GetComponent<TransformComponent>()->GetX());
+    }
+}
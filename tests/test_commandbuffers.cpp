@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include <core/entitymanager.hpp>
+#include <core/entitycommandbuffer.hpp>
+
+#include "test_components/components.hpp"
+
+TEST(CommandBuffers, DeferStructuralChanges)
+{
+    auto manager = CreateEntityManager();
+    std::vector<Entity> entities;
+    for (auto i = 0; i < 100; i++)
+    {
+        entities.emplace_back(manager->CreateEntityWith<TransformComponent>());
+        entities.back().GetComponent<TransformComponent>()->mData.x = static_cast<float>(i);
+    }
+
+    EntityCommandBuffer commands(*manager);
+    manager->With<TransformComponent>([&](Entity entity, TransformComponent* transform)
+                                      {
+                                          if (static_cast<int>(transform->GetX()) % 2 == 0)
+                                          {
+                                              commands.DestroyEntity(entity);
+                                              // recorded twice, applied once
+                                              commands.DestroyEntity(entity);
+                                          }
+                                          else
+                                          {
+                                              commands.AddComponent<PhysicsComponent>(entity);
+                                              commands.RemoveComponent<TransformComponent>(entity);
+                                          }
+                                          commands.CreateEntityWith<DummyComponent>();
+                                      });
+    EXPECT_EQ(300, commands.Size());
+    EXPECT_EQ(100, manager->Size());
+
+    commands.Playback();
+    EXPECT_TRUE(commands.IsEmpty());
+    EXPECT_EQ(150, manager->Size());
+    for (auto i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(i % 2 == 1, entities[i].IsValid());
+        if (i % 2 == 1)
+        {
+            EXPECT_TRUE(entities[i].HasComponent<PhysicsComponent>());
+            EXPECT_FALSE(entities[i].HasComponent<TransformComponent>());
+        }
+    }
+    EXPECT_EQ(100, manager->With<DummyComponent>().size());
+}
+
+TEST(CommandBuffers, RecordFromJobs)
+{
+    auto manager = CreateEntityManager();
+    manager->SetWorkerThreadCount(4);
+    for (auto i = 0; i < 5000; i++)
+    {
+        manager->CreateEntityWith<TransformComponent>();
+    }
+
+    EntityCommandBuffer commands(*manager);
+    manager->ParallelWith<TransformComponent>([&commands](Entity entity, TransformComponent*)
+                                              {
+                                                  commands.AddComponent<PhysicsComponent>(entity, [](PhysicsComponent* physics)
+                                                  {
+                                                      EXPECT_NE(nullptr, physics);
+                                                  });
+                                                  commands.CreateEntityWith<TransformComponent>([](Entity created)
+                                                                                                {
+                                                                                                    created.GetComponent<TransformComponent>()->mData.y = 1.0f;
+                                                                                                });
+                                              });
+    EXPECT_EQ(10000, commands.Size());
+    commands.Playback();
+    EXPECT_EQ(10000, manager->Size());
+    EXPECT_EQ(5000, manager->With<PhysicsComponent>().size());
+    auto created = 0;
+    manager->With<TransformComponent>([&created](Entity, TransformComponent* transform)
+                                      {
+                                          created += transform->GetY() == 1.0f ? 1 : 0;
+                                      });
+    EXPECT_EQ(5000, created);
+}
@@ -37,6 +37,12 @@ public:
     float GetX() const;
     float GetY() const;
 
+public:
+    static constexpr auto SerializedData()
+    {
+        return &TransformComponent::mData;
+    }
+
 public:
     struct
     {
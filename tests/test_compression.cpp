@@ -0,0 +1,119 @@
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <gtest/gtest.h>
+
+#include <core/jobsystem.hpp>
+#include <core/compression.hpp>
+
+static std::string RoundTrip(const std::string& data)
+{
+    std::vector<char> compressed(GetCompressedBlockBound(data.size()));
+    const auto compressedByteSize = CompressBlock(data.data(), data.size(), compressed.data());
+    EXPECT_LE(compressedByteSize, compressed.size());
+    std::string decompressed(data.size(), '\0');
+    DecompressBlock(compressed.data(), compressedByteSize, &decompressed[0], decompressed.size());
+    return decompressed;
+}
+
+TEST(Compression, BlockRoundTrip)
+{
+    std::mt19937 random(7);
+    std::string noise(70000, '\0');
+    for (auto& c : noise)
+    {
+        c = static_cast<char>(random());
+    }
+    std::string repeated;
+    for (auto i = 0; i < 5000; i++)
+    {
+        repeated += "component " + std::to_string(i % 17) + '\0';
+    }
+    // long literal and match lengths, overlapping matches and matches near the end
+    const std::vector<std::string> inputs = { "", "a", "abcd", std::string(1000, 'x'), std::string(100000, '\0'), noise, repeated, noise.substr(0, 300) + repeated + noise.substr(0, 300) };
+    for (const auto& input : inputs)
+    {
+        EXPECT_EQ(input, RoundTrip(input));
+    }
+
+    std::vector<char> compressed(GetCompressedBlockBound(repeated.size()));
+    const auto compressedByteSize = CompressBlock(repeated.data(), repeated.size(), compressed.data());
+    EXPECT_LT(compressedByteSize, repeated.size() / 10);
+    std::string decompressed(repeated.size(), '\0');
+    EXPECT_ANY_THROW(DecompressBlock(compressed.data(), compressedByteSize - 1, &decompressed[0], decompressed.size()));
+    EXPECT_ANY_THROW(DecompressBlock(compressed.data(), compressedByteSize, &decompressed[0], decompressed.size() - 1));
+}
+
+TEST(Compression, SnapshotBlocksDecodeInParallel)
+{
+    std::string snapshot;
+    for (auto i = 0; i < 100000; i++)
+    {
+        snapshot += std::to_string(i * 7);
+    }
+    std::ostringstream stream;
+    WriteCompressedSnapshot(snapshot, stream);
+    const auto compressed = stream.str();
+    EXPECT_LT(compressed.size(), snapshot.size());
+
+    JobSystem jobSystem(4);
+    for (auto parallel : { false, true })
+    {
+        std::istringstream is(compressed);
+        SnapshotStreamReader reader(is);
+        char magic[4];
+        reader.Read(magic, sizeof(magic));
+        ASSERT_TRUE(IsCompressedSnapshot(magic, sizeof(magic)));
+        auto decompressed = ReadCompressedSnapshot(reader, parallel ? &jobSystem : nullptr);
+        std::string data(snapshot.size(), '\0');
+        decompressed->Read(&data[0], data.size());
+        EXPECT_EQ(snapshot, data);
+        EXPECT_ANY_THROW(decompressed->Read(magic, 1));
+    }
+}
+
+TEST(Compression, CorruptedSnapshotCounts)
+{
+    // runs of zeros compress as far as the codec goes
+    const auto snapshot = std::string(300000, '\0') + "tail";
+    std::ostringstream stream;
+    WriteCompressedSnapshot(snapshot, stream);
+    const auto compressed = stream.str();
+    const auto read = [](const std::string& data)
+    {
+        std::istringstream is(data);
+        SnapshotStreamReader reader(is);
+        char magic[4];
+        reader.Read(magic, sizeof(magic));
+        return ReadCompressedSnapshot(reader, nullptr);
+    };
+    std::string data(snapshot.size(), '\0');
+    read(compressed)->Read(&data[0], data.size());
+    EXPECT_EQ(snapshot, data);
+
+    // a huge size or count anywhere is reported as corruption instead of being allocated
+    const std::uint64_t huge = std::uint64_t{ 1 } << 36;
+    for (std::size_t offset = 4; offset + sizeof(huge) <= compressed.size(); offset++)
+    {
+        auto corrupted = compressed;
+        std::memcpy(&corrupted[offset], &huge, sizeof(huge));
+        try
+        {
+            read(corrupted);
+        }
+        catch (const std::logic_error&)
+        {
+        }
+    }
+
+    // a consistent header announcing far more blocks than the stream holds
+    auto header = compressed.substr(0, 12);
+    const std::uint64_t byteSize = std::uint64_t{ 1 } << 50;
+    const std::uint64_t blockCount = byteSize / (128 * 1024);
+    header.append(reinterpret_cast<const char*>(&byteSize), sizeof(byteSize));
+    header.append(reinterpret_cast<const char*>(&blockCount), sizeof(blockCount));
+    EXPECT_THROW(read(header), std::logic_error);
+}
\ No newline at end of file
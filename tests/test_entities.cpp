@@ -1,3 +1,5 @@
+#include <cstring>
+#include <sstream>
 #include <gtest/gtest.h>
 
 #include <core/entitymanager.hpp>
@@ -217,4 +219,93 @@ TEST(Entity, SparseRepartitionExtreme)
         entities.emplace_back(entity);
     }
     EXPECT_EQ(4, entities.size());
-}
\ No newline at end of file
+}
+
+TEST(Entity, SparseRepartitionAcrossWords)
+{
+    auto manager = CreateEntityManager();
+    std::vector<Entity> created;
+    for (auto i = 0; i < 1000; i++)
+    {
+        created.emplace_back(manager->CreateEntity());
+    }
+    for (auto i = 0; i < 1000; i++)
+    {
+        if (i % 130 != 63)
+        {
+            created[i].Destroy();
+        }
+    }
+    std::vector<Entity> entities;
+    for (auto entity : *manager)
+    {
+        entities.emplace_back(entity);
+    }
+    ASSERT_EQ(8, entities.size());
+    EXPECT_EQ(manager->Size(), entities.size());
+    for (std::size_t i = 0; i < entities.size(); i++)
+    {
+        EXPECT_EQ(created[i * 130 + 63], entities[i]);
+    }
+}
+
+TEST(Components, TypeId)
+{
+    EXPECT_EQ(Component::TypeId<DummyComponent>(), Component::TypeId<DummyComponent>());
+    EXPECT_NE(Component::TypeId<DummyComponent>(), Component::TypeId<PhysicsComponent>());
+    EXPECT_NE(Component::TypeId<PhysicsComponent>(), Component::TypeId<TransformComponent>());
+    EXPECT_NE(Component::TypeId<DummyComponent>(), Component::TypeId<TransformComponent>());
+}
+
+TEST(Entity, WidePointers)
+{
+    auto manager = CreateEntityManager();
+    if (Entity::MaxIndex > std::numeric_limits<std::uint16_t>::max())
+    {
+        // more entities than a 16-bit handle can address, none of them alias
+        std::vector<Entity> entities;
+        for (auto i = 0; i < 70000; i++)
+        {
+            entities.emplace_back(manager->CreateEntity());
+        }
+        EXPECT_EQ(70000, manager->Size());
+        EXPECT_TRUE(entities.front().IsValid());
+        EXPECT_TRUE(entities.back().IsValid());
+        EXPECT_FALSE(entities.front() == entities[std::numeric_limits<std::uint16_t>::max() + 1]);
+    }
+    else
+    {
+        // a slot whose version saturates is retired instead of revalidating stale handles
+        auto first = manager->CreateEntity();
+        auto entity = first;
+        for (std::size_t i = 1; i < Entity::MaxVersion; i++)
+        {
+            entity.Destroy();
+            entity = manager->CreateEntity();
+        }
+        entity.Destroy();
+        EXPECT_EQ(0, manager->Size());
+        EXPECT_FALSE(first.IsValid());
+        EXPECT_FALSE(manager->CreateEntity() == first);
+        EXPECT_FALSE(first.IsValid());
+        EXPECT_EQ(1, manager->Size());
+    }
+
+    // a retired slot is neither alive nor free, a snapshot brings a slot one destroy away from retiring at any width
+    manager->Clear();
+    manager->CreateEntity();
+    manager->CreateEntity();
+    std::stringstream stream;
+    manager->Serialize(stream);
+    auto bytes = stream.str();
+    const auto lastVersion = static_cast<Entity::PointerSize>(Entity::MaxVersion - 1);
+    std::memcpy(&bytes[4 + 4 + 4 + 8], &lastVersion, sizeof(lastVersion));
+    stream.str(bytes);
+    manager->Deserialize(stream);
+    auto retired = *manager->begin();
+    retired.Destroy();
+    EXPECT_EQ(1, manager->Size());
+    EXPECT_EQ(1, manager->GetMemoryStats().mEntityCount);
+    manager->CreateEntity();
+    EXPECT_EQ(2, manager->Size());
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <core/entitymanager.hpp>
+#include <core/entitycommandbuffer.hpp>
 
 class BodyComponent final : public Component
 {
@@ -108,7 +109,7 @@ TEST(Lifecycle, Dependency_Mixed_Manual_Automatic_Lifecycle)
     // body was left out of the resolve
     // heart's reference to body is missing
     // body was loaded after heart, but can only be resolved if handled in OnLoad() method because OnResolveDependencies() would not be called...
-    // ...but since OnLoad() defaults to call OnResolveDependencies(), heart dep is resolved
+    // ...but since AddComponent() calls OnResolveDependencies() right after OnLoad(), heart dep is resolved
     // leg reference to heart is resolved, but not towards body
 
     EXPECT_EQ(nullptr, leg->mBodyComponent);
@@ -118,6 +119,33 @@ TEST(Lifecycle, Dependency_Mixed_Manual_Automatic_Lifecycle)
 
     entity.ResolveComponentDependencies();
 
+    EXPECT_EQ(body, leg->mBodyComponent);
+    EXPECT_EQ(heart, leg->mHeartComponent);
+    EXPECT_EQ(body, heart->mBodyComponent);
+    EXPECT_EQ(heart, body->mHeartComponent);
+}
+
+TEST(Lifecycle, Dependency_CommandBuffer_Lifecycle)
+{
+    EntityManager manager;
+    manager.RegisterComponent<BodyComponent>();
+    manager.RegisterComponent<HeartComponent>();
+    manager.RegisterComponent<LegMuscleComponent>();
+
+    EntityCommandBuffer commands(manager);
+    commands.CreateEntityWith<HeartComponent, BodyComponent, LegMuscleComponent>([](Entity entity)
+                                                                                 {
+                                                                                     // dependencies are resolved before init runs
+                                                                                     EXPECT_NE(nullptr, entity.GetComponent<BodyComponent>()->mHeartComponent);
+                                                                                 });
+    commands.Playback();
+    ASSERT_EQ(1, manager.Size());
+
+    auto entity = manager.With<BodyComponent>().front();
+    auto leg = entity.GetComponent<LegMuscleComponent>();
+    auto heart = entity.GetComponent<HeartComponent>();
+    auto body = entity.GetComponent<BodyComponent>();
+
     EXPECT_EQ(body, leg->mBodyComponent);
     EXPECT_EQ(heart, leg->mHeartComponent);
     EXPECT_EQ(body, heart->mBodyComponent);
@@ -1,12 +1,83 @@
+#include <atomic>
 #include <random>
+#include <string>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <sstream>
 #include <gtest/gtest.h>
 
 #include "core/entitymanager.hpp"
 
+#include "test_systems/systems.hpp"
 #include "test_components/components.hpp"
 
+class NameComponent final : public Component
+{
+public:
+    DECLARE_COMPONENT(NameComponent);
+
+public:
+    void Serialize(std::ostream& os) const override
+    {
+        os << mName << '\n';
+    }
+    void Deserialize(std::istream& is) override
+    {
+        std::getline(is, mName);
+    }
+
+public:
+    std::string mName;
+};
+
+DEFINE_COMPONENT(NameComponent);
+
+class LoadOrderComponent final : public Component
+{
+public:
+    DECLARE_COMPONENT(LoadOrderComponent);
+
+public:
+    static std::atomic<int> LoadedCount;
+
+public:
+    void OnLoad() override
+    {
+        LoadedCount += 1;
+    }
+    void OnResolveDependencies() override
+    {
+        mLoadedWhenResolved = LoadedCount;
+    }
+
+public:
+    int mLoadedWhenResolved = 0;
+};
+
+DEFINE_COMPONENT(LoadOrderComponent);
+std::atomic<int> LoadOrderComponent::LoadedCount{ 0 };
+
+// keeps the default OnLoad, which must not resolve anything
+class ResolveOnlyComponent final : public Component
+{
+public:
+    DECLARE_COMPONENT(ResolveOnlyComponent);
+
+public:
+    void OnResolveDependencies() override
+    {
+        mResolvedCount += 1;
+        mLoadedWhenResolved = LoadOrderComponent::LoadedCount;
+    }
+
+public:
+    int mResolvedCount = 0;
+    int mLoadedWhenResolved = 0;
+};
+
+DEFINE_COMPONENT(ResolveOnlyComponent);
+
 TEST(EntityManager, AnyAndWith)
 {
     auto manager = CreateEntityManager();
@@ -288,4 +359,766 @@ TEST(EntityManager, ExtremeSparseSaveAndLoad)
             ASSERT_EQ(entities[i * 2 + 1], entities2[i]);
         }
     }
-}
\ No newline at end of file
+}
+
+TEST(EntityManager, View)
+{
+    auto manager = CreateEntityManager();
+    auto entity1 = manager->CreateEntityWith<PhysicsComponent, TransformComponent>();
+    manager->CreateEntityWith<PhysicsComponent>();
+    manager->CreateEntity().Destroy();
+    auto entity2 = manager->CreateEntityWith<TransformComponent, PhysicsComponent, DummyComponent>();
+    entity1.GetComponent<TransformComponent>()->mData.x = 1.0f;
+    entity2.GetComponent<TransformComponent>()->mData.x = 2.0f;
+
+    std::vector<Entity> entities;
+    for (auto tuple : manager->View<TransformComponent, PhysicsComponent>())
+    {
+        entities.emplace_back(std::get<0>(tuple));
+        EXPECT_EQ(std::get<0>(tuple).GetComponent<TransformComponent>(), &std::get<1>(tuple));
+        EXPECT_EQ(std::get<0>(tuple).GetComponent<PhysicsComponent>(), &std::get<2>(tuple));
+        std::get<1>(tuple).mData.y = std::get<1>(tuple).mData.x * 10.0f;
+    }
+    ASSERT_EQ(2, entities.size());
+    EXPECT_EQ(entity1, entities[0]);
+    EXPECT_EQ(entity2, entities[1]);
+    EXPECT_EQ(10.0f, entity1.GetComponent<TransformComponent>()->GetY());
+    EXPECT_EQ(20.0f, entity2.GetComponent<TransformComponent>()->GetY());
+
+    auto count = 0;
+    manager->View<TransformComponent>().Each([&](Entity entity, TransformComponent& transform)
+                                             {
+                                                 EXPECT_EQ(entity.GetComponent<TransformComponent>(), &transform);
+                                                 count += 1;
+                                             });
+    EXPECT_EQ(2, count);
+}
+
+TEST(EntityManager, Query)
+{
+    auto manager = CreateEntityManager();
+    auto entity1 = manager->CreateEntityWith<PhysicsComponent, TransformComponent>();
+    auto entity2 = manager->CreateEntityWith<PhysicsComponent>();
+    auto query = manager->Query<PhysicsComponent, TransformComponent>();
+    ASSERT_EQ(1, query.Size());
+
+    // membership follows structural changes without rescanning
+    entity2.AddComponent<TransformComponent>();
+    EXPECT_EQ(2, query.Size());
+    entity1.RemoveComponent<TransformComponent>();
+    EXPECT_EQ(1, query.Size());
+    auto entity3 = manager->CreateEntityWith<TransformComponent, PhysicsComponent, DummyComponent>();
+    EXPECT_EQ(2, query.Size());
+    EXPECT_EQ(3, manager->Query<>().Size());
+    entity2.Destroy();
+    EXPECT_EQ(1, query.Size());
+
+    std::vector<Entity> entities;
+    for (auto tuple : query)
+    {
+        entities.emplace_back(std::get<0>(tuple));
+        EXPECT_EQ(std::get<0>(tuple).GetComponent<PhysicsComponent>(), &std::get<1>(tuple));
+        EXPECT_EQ(std::get<0>(tuple).GetComponent<TransformComponent>(), &std::get<2>(tuple));
+    }
+    ASSERT_EQ(1, entities.size());
+    EXPECT_EQ(entity3, entities[0]);
+
+    std::stringstream stream;
+    manager->Serialize(stream);
+    manager->Deserialize(stream);
+    auto count = 0;
+    query.Each([&](Entity entity, PhysicsComponent&, TransformComponent& transform)
+               {
+                   EXPECT_EQ(entity3, entity);
+                   EXPECT_EQ(entity.GetComponent<TransformComponent>(), &transform);
+                   count += 1;
+               });
+    EXPECT_EQ(1, count);
+
+    manager->Clear();
+    EXPECT_EQ(0, query.Size());
+    manager->CreateEntityWith<TransformComponent, PhysicsComponent>();
+    EXPECT_EQ(1, query.Size());
+}
+
+TEST(EntityManager, ComponentArena)
+{
+    alignas(std::max_align_t) static unsigned char memory[64 * 1024];
+    ComponentArena arena(memory, sizeof(memory));
+    auto manager = CreateEntityManager();
+    manager->SetComponentArena(&arena);
+
+    auto entity1 = manager->CreateEntityWith<TransformComponent>();
+    auto transform = entity1.GetComponent<TransformComponent>();
+    auto address = reinterpret_cast<unsigned char*>(transform);
+    EXPECT_TRUE(address >= memory && address < memory + sizeof(memory));
+    EXPECT_GT(arena.GetUsedByteSize(), 0);
+
+    // a freed slot is handed out again before the pool grows
+    entity1.Destroy();
+    auto entity2 = manager->CreateEntityWith<TransformComponent>();
+    EXPECT_EQ(transform, entity2.GetComponent<TransformComponent>());
+
+    // once the arena is exhausted slabs come from the global heap
+    std::vector<Entity> entities;
+    for (auto i = 0; i < 10000; i++)
+    {
+        entities.emplace_back(manager->CreateEntityWith<TransformComponent, PhysicsComponent>());
+        entities.back().GetComponent<TransformComponent>()->mData.x = static_cast<float>(i);
+    }
+    EXPECT_LE(arena.GetUsedByteSize(), arena.GetByteSize());
+    for (auto i = 0; i < 10000; i++)
+    {
+        EXPECT_EQ(static_cast<float>(i), entities[i].GetComponent<TransformComponent>()->GetX());
+    }
+    manager->Clear();
+    EXPECT_EQ(0, manager->Size());
+}
+
+TEST(EntityManager, ParallelWith)
+{
+    auto manager = CreateEntityManager();
+    manager->SetWorkerThreadCount(4);
+    EXPECT_EQ(4, manager->GetJobSystem().GetThreadCount());
+    for (auto i = 0; i < 10000; i++)
+    {
+        auto entity = manager->CreateEntityWith<TransformComponent>();
+        entity.GetComponent<TransformComponent>()->mData.x = static_cast<float>(i);
+        if (i % 3 == 0)
+        {
+            entity.AddComponent<PhysicsComponent>();
+        }
+    }
+
+    std::atomic<int> count{ 0 };
+    manager->ParallelWith<TransformComponent, PhysicsComponent>([&](Entity entity, TransformComponent* transform, PhysicsComponent* physics)
+                                                                {
+                                                                    EXPECT_EQ(entity.GetComponent<PhysicsComponent>(), physics);
+                                                                    transform->mData.y = transform->mData.x * 2.0f;
+                                                                    count += 1;
+                                                                });
+    EXPECT_EQ(3334, count);
+    auto index = 0;
+    for (auto tuple : manager->View<TransformComponent>())
+    {
+        EXPECT_EQ(index % 3 == 0 ? index * 2.0f : 0.0f, std::get<1>(tuple).GetY());
+        index += 1;
+    }
+
+    // the first exception thrown by a worker reaches the caller
+    EXPECT_ANY_THROW(manager->ParallelWith<TransformComponent>([](Entity, TransformComponent* transform)
+                                                               {
+                                                                   if (transform->GetX() == 5000.0f)
+                                                                   {
+                                                                       throw std::runtime_error("ParallelWith");
+                                                                   }
+                                                               }));
+}
+
+TEST(EntityManager, CreateEntitiesWith)
+{
+    auto manager = CreateEntityManager();
+    auto destroyed = manager->CreateEntity();
+    auto kept = manager->CreateEntityWith<DummyComponent>();
+    destroyed.Destroy();
+
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent, PhysicsComponent>(1000, entities);
+    ASSERT_EQ(1000, entities.size());
+    EXPECT_EQ(1001, manager->Size());
+    // the free index is recycled with its bumped version
+    EXPECT_FALSE(destroyed.IsValid());
+    EXPECT_TRUE(kept.IsValid());
+    for (auto& entity : entities)
+    {
+        ASSERT_TRUE(entity.IsValid());
+        EXPECT_TRUE((entity.HasComponent<TransformComponent, PhysicsComponent>()));
+        EXPECT_FALSE(entity.HasComponent<DummyComponent>());
+    }
+    EXPECT_EQ(1000, manager->Query<TransformComponent>().Size());
+    EXPECT_EQ(1000, manager->With<PhysicsComponent>().size());
+
+    manager->CreateEntitiesWith<>(10, entities);
+    EXPECT_EQ(1010, entities.size());
+    EXPECT_EQ(1011, manager->Size());
+    EXPECT_ANY_THROW((manager->CreateEntitiesWith<TransformComponent, TransformComponent>(1, entities)));
+}
+
+TEST(EntityManager, DestroyEntities)
+{
+    auto manager = CreateEntityManager();
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent>(100, entities);
+    manager->CreateEntitiesWith<TransformComponent, PhysicsComponent>(100, entities);
+    auto query = manager->Query<TransformComponent>();
+
+    std::vector<Entity> destroyed(entities.begin(), entities.begin() + 50);
+    destroyed.emplace_back(entities[0]);
+    manager->DestroyEntities(destroyed);
+    EXPECT_EQ(150, manager->Size());
+    EXPECT_EQ(150, query.Size());
+    EXPECT_FALSE(entities[0].IsValid());
+    EXPECT_TRUE(entities[50].IsValid());
+    // nothing is destroyed when one of the entities is invalid
+    EXPECT_ANY_THROW(manager->DestroyEntities(entities.begin(), entities.begin() + 60));
+    EXPECT_TRUE(entities[55].IsValid());
+
+    manager->DestroyWith<PhysicsComponent>();
+    EXPECT_EQ(50, manager->Size());
+    EXPECT_EQ(50, query.Size());
+    EXPECT_EQ(0, manager->With<PhysicsComponent>().size());
+    for (auto i = 50; i < 100; i++)
+    {
+        EXPECT_TRUE(entities[i].HasComponent<TransformComponent>());
+    }
+
+    // freed slots are reused by later creations
+    std::vector<Entity> recreated;
+    manager->CreateEntitiesWith<DummyComponent>(150, recreated);
+    EXPECT_EQ(200, manager->Size());
+    EXPECT_EQ(150, manager->With<DummyComponent>().size());
+}
+
+TEST(EntityManager, ReserveAndShrinkToFit)
+{
+    auto manager = CreateEntityManager();
+    manager->Reserve<TransformComponent, PhysicsComponent>(10000, { 10000, 5000 });
+    EXPECT_GE(manager->Capacity(), 10000);
+    EXPECT_GE(manager->ComponentCapacity<TransformComponent>(), 10000);
+    EXPECT_GE(manager->ComponentCapacity<PhysicsComponent>(), 5000);
+    EXPECT_EQ(0, manager->ComponentCapacity<DummyComponent>());
+
+    // reserved tables are not reallocated by creations within the reserved counts
+    const auto capacity = manager->Capacity();
+    const auto transformCapacity = manager->ComponentCapacity<TransformComponent>();
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent>(10000, entities);
+    EXPECT_EQ(capacity, manager->Capacity());
+    EXPECT_EQ(transformCapacity, manager->ComponentCapacity<TransformComponent>());
+
+    // only the dead slots after the last alive entity are trimmed
+    for (auto i = 0; i < 100; i++)
+    {
+        entities[i].GetComponent<TransformComponent>()->mData.x = static_cast<float>(i);
+    }
+    entities[50].Destroy();
+    manager->DestroyEntities(entities.begin() + 100, entities.end());
+    manager->ShrinkToFit();
+    EXPECT_EQ(99, manager->Size());
+    EXPECT_LT(manager->Capacity(), 1000);
+    EXPECT_LT(manager->ComponentCapacity<TransformComponent>(), 1000);
+    for (auto i = 0; i < 100; i++)
+    {
+        ASSERT_EQ(i != 50, entities[i].IsValid());
+        if (i != 50)
+        {
+            EXPECT_EQ(static_cast<float>(i), entities[i].GetComponent<TransformComponent>()->GetX());
+        }
+    }
+
+    // handles to trimmed slots stay invalid once their index is handed out again
+    std::vector<Entity> recreated;
+    manager->CreateEntitiesWith<TransformComponent>(2, recreated);
+    manager->CreateEntitiesWith<TransformComponent>(1, recreated);
+    EXPECT_FALSE(entities[100].IsValid());
+    EXPECT_FALSE(entities[101].IsValid());
+    EXPECT_TRUE(recreated[1].IsValid());
+    EXPECT_TRUE(recreated[2].IsValid());
+    EXPECT_EQ(102, manager->Size());
+}
+
+TEST(EntityManager, MemoryStats)
+{
+    auto manager = CreateEntityManager();
+    manager->AddSystem<WorldStateSystem>(nullptr, nullptr);
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent>(1000, entities);
+    manager->CreateEntitiesWith<TransformComponent, PhysicsComponent>(500, entities);
+    manager->Query<PhysicsComponent>();
+    manager->DestroyEntities(entities.begin(), entities.begin() + 100);
+
+    auto stats = manager->GetMemoryStats();
+    ASSERT_EQ(3, stats.mComponents.size());
+    for (const auto& component : stats.mComponents)
+    {
+        if (component.mName == TransformComponent::ComponentName)
+        {
+            EXPECT_EQ(1400, component.mCount);
+            EXPECT_GE(component.mCapacity, 1400);
+            EXPECT_EQ(1400 * sizeof(TransformComponent), component.mUsedByteSize);
+            EXPECT_GE(component.mByteSize, component.mUsedByteSize);
+        }
+        else if (component.mName == PhysicsComponent::ComponentName)
+        {
+            EXPECT_EQ(500, component.mCount);
+        }
+        else
+        {
+            EXPECT_EQ(DummyComponent::ComponentName, component.mName);
+            EXPECT_EQ(0, component.mCount);
+        }
+    }
+    EXPECT_EQ(1400, stats.mEntityCount);
+    EXPECT_EQ(1500, stats.mEntitySlotCount);
+    EXPECT_EQ(100, stats.mFreeIndexCount);
+    EXPECT_EQ(1, stats.mQueryCount);
+    EXPECT_GT(stats.mQueryByteSize, 0);
+    EXPECT_EQ(1, stats.mSystemCount);
+    EXPECT_GE(stats.mSystemByteSize, sizeof(WorldStateSystem));
+    EXPECT_GT(stats.GetFragmentation(), 0.0f);
+    EXPECT_LT(stats.GetFragmentation(), 1.0f);
+    EXPECT_GT(stats.GetByteSize(), stats.GetComponentUsedByteSize());
+
+    // refreshing the same stats reuses them
+    manager->DestroyEntities(manager->With<PhysicsComponent>());
+    manager->GetMemoryStats(stats);
+    EXPECT_EQ(900, stats.mEntityCount);
+    EXPECT_EQ(3, stats.mComponents.size());
+}
+
+TEST(EntityManager, SnapshotFormat)
+{
+    auto manager = CreateEntityManager();
+    manager->RegisterComponent<NameComponent>(ComponentStorage::eSparseSet);
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent, NameComponent>(100, entities);
+    for (auto i = 0; i < 100; i++)
+    {
+        // bytes the former token based loader skipped as whitespace
+        const unsigned char bytes[] = { ' ', '\t', '\n', static_cast<unsigned char>(i) };
+        std::memcpy(&entities[i].GetComponent<TransformComponent>()->mData.x, bytes, sizeof(bytes));
+        entities[i].GetComponent<NameComponent>()->mName = "entity " + std::to_string(i);
+    }
+    manager->DestroyEntities(entities.begin(), entities.begin() + 10);
+    auto recycled = manager->CreateEntity();
+
+    std::stringstream stream;
+    manager->Serialize(stream);
+    const auto snapshot = stream.str();
+    manager->Clear();
+    manager->Deserialize(stream);
+    EXPECT_EQ(91, manager->Size());
+    EXPECT_TRUE(recycled.IsValid());
+    EXPECT_FALSE(entities[0].IsValid());
+    for (auto i = 10; i < 100; i++)
+    {
+        const unsigned char bytes[] = { ' ', '\t', '\n', static_cast<unsigned char>(i) };
+        ASSERT_TRUE(entities[i].IsValid());
+        EXPECT_EQ(0, std::memcmp(&entities[i].GetComponent<TransformComponent>()->mData.x, bytes, sizeof(bytes)));
+        EXPECT_EQ("entity " + std::to_string(i), entities[i].GetComponent<NameComponent>()->mName);
+    }
+    // the free list survives, the next creation reuses the same slot as before saving
+    auto created = manager->CreateEntity();
+    manager->Deserialize(stream.seekg(0));
+    EXPECT_EQ(created, manager->CreateEntity());
+
+    std::istringstream truncated(snapshot.substr(0, snapshot.size() - 1));
+    EXPECT_ANY_THROW(manager->Deserialize(truncated));
+    std::istringstream garbage("not a snapshot");
+    EXPECT_ANY_THROW(manager->Deserialize(garbage));
+    std::istringstream unregistered(snapshot);
+    auto other = CreateEntityManager();
+    EXPECT_ANY_THROW(other->Deserialize(unregistered));
+}
+
+TEST(EntityManager, LoadSnapshot)
+{
+    auto manager = CreateEntityManager();
+    manager->RegisterComponent<NameComponent>(ComponentStorage::eSparseSet);
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent, NameComponent>(100, entities);
+    manager->CreateEntitiesWith<PhysicsComponent>(100, entities);
+    for (auto i = 0; i < 100; i++)
+    {
+        entities[i].GetComponent<TransformComponent>()->mData.x = static_cast<float>(i);
+        entities[i].GetComponent<NameComponent>()->mName = "entity " + std::to_string(i);
+    }
+    std::string snapshot;
+    {
+        std::ofstream os("snapshot.bin", std::ios::out | std::ios::binary);
+        manager->Serialize(os);
+        std::ostringstream stream;
+        manager->Serialize(stream);
+        snapshot = stream.str();
+    }
+
+    manager->LoadSnapshot("snapshot.bin");
+    EXPECT_EQ(200, manager->Size());
+    EXPECT_EQ(100, manager->Query<TransformComponent>().Size());
+    // nothing is built before the first access to its type
+    const auto countOf = [&manager](const std::string& name)
+    {
+        for (const auto& component : manager->GetMemoryStats().mComponents)
+        {
+            if (component.mName == name)
+            {
+                return component.mCount;
+            }
+        }
+        return std::size_t{ 0 };
+    };
+    EXPECT_EQ(0, countOf(TransformComponent::ComponentName));
+    EXPECT_EQ(0, countOf(NameComponent::ComponentName));
+    EXPECT_TRUE(entities[0].HasComponent<TransformComponent>());
+
+    // entities destroyed before their components were built are skipped
+    entities[1].Destroy();
+    EXPECT_EQ(0.0f, entities[0].GetComponent<TransformComponent>()->GetX());
+    EXPECT_EQ(99, countOf(TransformComponent::ComponentName));
+    EXPECT_EQ(0, countOf(NameComponent::ComponentName));
+    EXPECT_EQ(2.0f, entities[2].GetComponent<TransformComponent>()->GetX());
+    entities[3].RemoveComponent<NameComponent>();
+    EXPECT_EQ(98, countOf(NameComponent::ComponentName));
+    EXPECT_EQ("entity 4", entities[4].GetComponent<NameComponent>()->mName);
+    EXPECT_EQ(100, manager->With<PhysicsComponent>().size());
+
+    // a fully built snapshot saves the same bytes
+    manager->LoadSnapshot("snapshot.bin");
+    std::ostringstream stream;
+    manager->Serialize(stream);
+    EXPECT_EQ(snapshot, stream.str());
+    EXPECT_ANY_THROW(manager->LoadSnapshot("missing.bin"));
+}
+
+TEST(EntityManager, DeltaSnapshot)
+{
+    auto manager = CreateEntityManager();
+    manager->RegisterComponent<NameComponent>(ComponentStorage::eSparseSet);
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent, NameComponent>(1000, entities);
+    for (auto i = 0; i < 1000; i++)
+    {
+        entities[i].GetComponent<NameComponent>()->mName = "entity " + std::to_string(i);
+    }
+    std::stringstream baseline;
+    manager->Serialize(baseline);
+    auto replica = CreateEntityManager();
+    replica->RegisterComponent<NameComponent>(ComponentStorage::eSparseSet);
+    replica->Deserialize(baseline);
+    manager->ClearChanges();
+
+    // reading through const accessors is not a change
+    const auto& constEntity = entities[0];
+    EXPECT_NE(nullptr, constEntity.GetComponent<TransformComponent>());
+    std::stringstream empty;
+    manager->SerializeDelta(empty);
+
+    entities[1].GetComponent<TransformComponent>()->mData.x = 1.0f;
+    for (auto i = 0; i < 1000; i += 100)
+    {
+        entities[i].GetComponent<NameComponent>()->mName += " renamed";
+    }
+    entities[2].RemoveComponent<NameComponent>();
+    entities[3].AddComponent<PhysicsComponent>();
+    manager->DestroyEntities(entities.begin() + 10, entities.begin() + 20);
+    manager->CreateEntityWith<PhysicsComponent>();
+    std::vector<Entity> created;
+    manager->CreateEntitiesWith<TransformComponent>(50, created);
+    created[0].GetComponent<TransformComponent>()->mData.y = 2.0f;
+
+    std::stringstream delta;
+    manager->SerializeDelta(delta);
+    EXPECT_LT(delta.str().size(), baseline.str().size() / 4);
+    EXPECT_GT(delta.str().size(), empty.str().size());
+    replica->ApplyDelta(delta);
+
+    std::ostringstream expected;
+    manager->Serialize(expected);
+    std::ostringstream actual;
+    replica->Serialize(actual);
+    EXPECT_EQ(expected.str(), actual.str());
+    EXPECT_EQ(manager->Size(), replica->Size());
+    EXPECT_EQ(1, (replica->Query<PhysicsComponent, TransformComponent>().Size()));
+    EXPECT_EQ(2, replica->With<PhysicsComponent>().size());
+
+    // deltas chain, applying one leaves the replica clean
+    manager->ClearChanges();
+    created[1].Destroy();
+    std::stringstream next;
+    manager->SerializeDelta(next);
+    replica->ApplyDelta(next);
+    manager->ClearChanges();
+    std::ostringstream unchanged;
+    manager->SerializeDelta(unchanged);
+    std::ostringstream replicaUnchanged;
+    replica->SerializeDelta(replicaUnchanged);
+    EXPECT_EQ(unchanged.str(), replicaUnchanged.str());
+    EXPECT_EQ(manager->Size(), replica->Size());
+
+    std::istringstream garbage("not a delta");
+    EXPECT_ANY_THROW(replica->ApplyDelta(garbage));
+    EXPECT_EQ(0, replica->Size());
+}
+
+TEST(EntityManager, ReadOnlyAccessLeavesDeltaEmpty)
+{
+    auto manager = CreateEntityManager();
+    manager->RegisterComponent<NameComponent>(ComponentStorage::eSparseSet);
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent, NameComponent>(1000, entities);
+    manager->ClearChanges();
+    std::ostringstream empty;
+    manager->SerializeDelta(empty);
+
+    // const component types read without marking anything as changed
+    auto read = 0.0f;
+    manager->With<const TransformComponent, const NameComponent>([&read](Entity, const TransformComponent* transform, const NameComponent*)
+                                                                 {
+                                                                     read += transform->GetX();
+                                                                 });
+    manager->Any<const TransformComponent>([&read](Entity, const TransformComponent* transform)
+                                           {
+                                               read += transform->GetY();
+                                           });
+    manager->ParallelWith<const TransformComponent>([](Entity, const TransformComponent*)
+                                                    {
+                                                    });
+    for (auto element : manager->View<const TransformComponent>())
+    {
+        read += std::get<1>(element).GetX();
+    }
+    manager->Query<const NameComponent>().Each([](Entity, const NameComponent&)
+                                               {
+                                               });
+    entities[0].With<const TransformComponent>([](const TransformComponent*)
+                                               {
+                                               });
+    std::ostringstream unchanged;
+    manager->SerializeDelta(unchanged);
+    EXPECT_EQ(empty.str(), unchanged.str());
+    EXPECT_EQ(0.0f, read);
+
+    // only the mutable types of a mixed traversal are marked
+    manager->With<TransformComponent, const NameComponent>([](Entity, TransformComponent* transform, const NameComponent*)
+                                                           {
+                                                               transform->mData.x = 1.0f;
+                                                           });
+    std::ostringstream changed;
+    manager->SerializeDelta(changed);
+    EXPECT_GT(changed.str().size(), empty.str().size());
+    manager->ClearChanges();
+    manager->With<TransformComponent>([](Entity, TransformComponent*)
+                                      {
+                                      });
+    std::ostringstream transforms;
+    manager->SerializeDelta(transforms);
+    EXPECT_EQ(transforms.str(), changed.str());
+}
+
+TEST(EntityManager, SerializeAsync)
+{
+    auto manager = CreateEntityManager();
+    manager->RegisterComponent<NameComponent>(ComponentStorage::eSparseSet);
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent, NameComponent>(1000, entities);
+    for (auto i = 0; i < 1000; i++)
+    {
+        entities[i].GetComponent<TransformComponent>()->mData.x = static_cast<float>(i);
+        entities[i].GetComponent<NameComponent>()->mName = "entity " + std::to_string(i);
+    }
+    std::ostringstream expected;
+    manager->Serialize(expected);
+
+    // the world is copied before SerializeAsync returns, changes made while it serializes and writes are not saved
+    std::ostringstream stream;
+    auto saved = manager->SerializeAsync(stream);
+    for (auto i = 0; i < 1000; i += 2)
+    {
+        entities[i].GetComponent<TransformComponent>()->mData.x = -1.0f;
+        entities[i].GetComponent<NameComponent>()->mName = "renamed while saving";
+        entities[i + 1].Destroy();
+    }
+    manager->CreateEntityWith<PhysicsComponent>();
+    saved.get();
+    EXPECT_EQ(expected.str(), stream.str());
+
+    std::ostringstream failed;
+    failed.setstate(std::ios::badbit);
+    auto failedSave = manager->SerializeAsync(failed);
+    EXPECT_ANY_THROW(failedSave.get());
+}
+
+TEST(EntityManager, DeserializeResolvesAfterLoad)
+{
+    auto manager = CreateEntityManager();
+    manager->RegisterComponent<LoadOrderComponent>(ComponentStorage::eSparseSet);
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<LoadOrderComponent, TransformComponent>(5000, entities);
+    std::stringstream stream;
+    manager->Serialize(stream);
+
+    // every OnLoad of the snapshot ran before the first OnResolveDependencies, on the calling thread or on the job system
+    for (auto parallel : { false, true })
+    {
+        manager->SetParallelSnapshotLoad(parallel);
+        LoadOrderComponent::LoadedCount = 0;
+        manager->Deserialize(stream.seekg(0));
+        EXPECT_EQ(5000, LoadOrderComponent::LoadedCount);
+        for (const auto& entity : entities)
+        {
+            const auto component = entity.GetComponent<LoadOrderComponent>();
+            ASSERT_NE(nullptr, component);
+            EXPECT_EQ(5000, component->mLoadedWhenResolved);
+        }
+    }
+
+    // parallel loading still builds lazily, then builds every pending type on the first access
+    std::ofstream("snapshot.bin", std::ios::out | std::ios::binary) << stream.str();
+    LoadOrderComponent::LoadedCount = 0;
+    manager->LoadSnapshot("snapshot.bin");
+    EXPECT_EQ(0, LoadOrderComponent::LoadedCount);
+    EXPECT_NE(nullptr, entities[0].GetComponent<TransformComponent>());
+    EXPECT_EQ(5000, LoadOrderComponent::LoadedCount);
+}
+
+TEST(EntityManager, DeserializeResolvesOnce)
+{
+    auto manager = CreateEntityManager();
+    manager->RegisterComponent<LoadOrderComponent>();
+    manager->RegisterComponent<ResolveOnlyComponent>(ComponentStorage::eSparseSet);
+    std::vector<Entity> entities;
+    LoadOrderComponent::LoadedCount = 0;
+    manager->CreateEntitiesWith<LoadOrderComponent, ResolveOnlyComponent>(5000, entities);
+    for (const auto& entity : entities)
+    {
+        EXPECT_EQ(1, entity.GetComponent<ResolveOnlyComponent>()->mResolvedCount);
+        EXPECT_EQ(5000, entity.GetComponent<ResolveOnlyComponent>()->mLoadedWhenResolved);
+    }
+    // adding a component resolves only that component
+    entities[0].AddComponent<TransformComponent>();
+    EXPECT_EQ(1, entities[0].GetComponent<ResolveOnlyComponent>()->mResolvedCount);
+    std::stringstream stream;
+    manager->Serialize(stream);
+
+    // the default OnLoad does not resolve, each component is resolved once after every OnLoad of the snapshot
+    for (auto parallel : { false, true })
+    {
+        manager->SetParallelSnapshotLoad(parallel);
+        LoadOrderComponent::LoadedCount = 0;
+        manager->Deserialize(stream.seekg(0));
+        for (const auto& entity : entities)
+        {
+            const auto component = entity.GetComponent<ResolveOnlyComponent>();
+            ASSERT_NE(nullptr, component);
+            EXPECT_EQ(1, component->mResolvedCount);
+            EXPECT_EQ(5000, component->mLoadedWhenResolved);
+        }
+    }
+}
+
+TEST(EntityManager, CorruptedSnapshotCounts)
+{
+    auto manager = CreateEntityManager();
+    manager->RegisterComponent<NameComponent>(ComponentStorage::eSparseSet);
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent, NameComponent>(4, entities);
+    entities[1].Destroy();
+    std::ostringstream stream;
+    manager->Serialize(stream);
+    const auto snapshot = stream.str();
+
+    // a huge count or size anywhere in the snapshot is reported as corruption instead of being allocated
+    const std::uint64_t huge = std::uint64_t{ 1 } << 36;
+    for (std::size_t offset = 0; offset + sizeof(huge) <= snapshot.size(); offset++)
+    {
+        auto corrupted = snapshot;
+        std::memcpy(&corrupted[offset], &huge, sizeof(huge));
+        std::istringstream is(corrupted);
+        try
+        {
+            manager->Deserialize(is);
+        }
+        catch (const std::length_error&)
+        {
+            ADD_FAILURE() << "length error at offset " << offset;
+        }
+        catch (const std::logic_error&)
+        {
+        }
+    }
+}
+
+TEST(EntityManager, CorruptedDeltaCounts)
+{
+    auto manager = CreateEntityManager();
+    manager->RegisterComponent<NameComponent>(ComponentStorage::eSparseSet);
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent, NameComponent>(4, entities);
+    std::ostringstream baseline;
+    manager->Serialize(baseline);
+    manager->ClearChanges();
+    entities[1].Destroy();
+    entities[2].RemoveComponent<NameComponent>();
+    entities[3].GetComponent<TransformComponent>()->mData.x = 1.0f;
+    manager->CreateEntityWith<NameComponent>();
+    std::ostringstream stream;
+    manager->SerializeDelta(stream);
+    const auto delta = stream.str();
+
+    // a huge count or size anywhere in the delta is reported as corruption instead of being allocated
+    auto replica = CreateEntityManager();
+    replica->RegisterComponent<NameComponent>(ComponentStorage::eSparseSet);
+    const std::uint64_t huge = std::uint64_t{ 1 } << 36;
+    for (std::size_t offset = 0; offset + sizeof(huge) <= delta.size(); offset++)
+    {
+        std::istringstream baselineStream(baseline.str());
+        replica->Deserialize(baselineStream);
+        auto corrupted = delta;
+        std::memcpy(&corrupted[offset], &huge, sizeof(huge));
+        std::istringstream is(corrupted);
+        try
+        {
+            replica->ApplyDelta(is);
+        }
+        catch (const std::length_error&)
+        {
+            ADD_FAILURE() << "length error at offset " << offset;
+        }
+        catch (const std::logic_error&)
+        {
+        }
+    }
+}
+
+TEST(EntityManager, CompressedSnapshot)
+{
+    auto manager = CreateEntityManager();
+    manager->RegisterComponent<NameComponent>(ComponentStorage::eSparseSet);
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent, NameComponent>(20000, entities);
+    manager->CreateEntitiesWith<PhysicsComponent>(20000, entities);
+    for (auto i = 0; i < 20000; i++)
+    {
+        entities[i].GetComponent<TransformComponent>()->mData.x = static_cast<float>(i % 10);
+        entities[i].GetComponent<NameComponent>()->mName = "entity " + std::to_string(i);
+    }
+    std::ostringstream plain;
+    manager->Serialize(plain);
+    std::stringstream compressed;
+    manager->Serialize(compressed, SnapshotCompression::eBlock);
+    EXPECT_LT(compressed.str().size(), plain.str().size() / 2);
+
+    // Deserialize and LoadSnapshot both recognize a compressed snapshot
+    manager->Clear();
+    manager->Deserialize(compressed);
+    std::ostringstream loaded;
+    manager->Serialize(loaded);
+    EXPECT_EQ(plain.str(), loaded.str());
+    std::ofstream("snapshot.bin", std::ios::out | std::ios::binary) << compressed.str();
+    manager->LoadSnapshot("snapshot.bin");
+    EXPECT_EQ("entity 123", entities[123].GetComponent<NameComponent>()->mName);
+    std::ostringstream mapped;
+    manager->Serialize(mapped);
+    EXPECT_EQ(plain.str(), mapped.str());
+
+    std::ostringstream async;
+    manager->SerializeAsync(async, SnapshotCompression::eBlock).get();
+    EXPECT_EQ(compressed.str(), async.str());
+
+    auto corrupted = compressed.str();
+    corrupted[corrupted.size() / 2] ^= 0x5a;
+    corrupted.resize(corrupted.size() - 10);
+    std::istringstream truncated(corrupted);
+    EXPECT_ANY_THROW(manager->Deserialize(truncated));
+    EXPECT_EQ(0, manager->Size());
+}
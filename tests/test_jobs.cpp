@@ -0,0 +1,151 @@
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+#include <gtest/gtest.h>
+
+#include <core/jobsystem.hpp>
+#include <core/entitymanager.hpp>
+
+#include "test_components/components.hpp"
+
+TEST(Jobs, ScheduleAndWait)
+{
+    JobSystem jobSystem(4);
+    EXPECT_EQ(4, jobSystem.GetThreadCount());
+    EXPECT_TRUE(JobHandle().IsDone());
+
+    std::atomic<int> count{ 0 };
+    std::vector<JobHandle> handles;
+    for (auto i = 0; i < 100; i++)
+    {
+        handles.emplace_back(jobSystem.Schedule([&count] { count += 1; }));
+    }
+    for (const auto& handle : handles)
+    {
+        jobSystem.Wait(handle);
+        EXPECT_TRUE(handle.IsDone());
+    }
+    EXPECT_EQ(100, count);
+}
+
+TEST(Jobs, NestedJobs)
+{
+    JobSystem jobSystem(3);
+    std::vector<int> values(100000, 0);
+    // jobs waiting on jobs they scheduled keep running work instead of blocking a thread
+    auto handle = jobSystem.Schedule([&]
+                                     {
+                                         auto first = jobSystem.ScheduleParallelFor(values.size() / 2, 100, [&](std::size_t begin, std::size_t end)
+                                         {
+                                             for (auto i = begin; i < end; i++)
+                                             {
+                                                 values[i] += 1;
+                                             }
+                                         });
+                                         jobSystem.ParallelFor(values.size() / 2, 100, [&](std::size_t begin, std::size_t end)
+                                         {
+                                             for (auto i = begin; i < end; i++)
+                                             {
+                                                 values[values.size() / 2 + i] += 2;
+                                             }
+                                         });
+                                         jobSystem.Wait(first);
+                                     });
+    jobSystem.Wait(handle);
+    for (std::size_t i = 0; i < values.size(); i++)
+    {
+        ASSERT_EQ(i < values.size() / 2 ? 1 : 2, values[i]);
+    }
+}
+
+TEST(Jobs, Exceptions)
+{
+    JobSystem jobSystem(2);
+    auto handle = jobSystem.ScheduleParallelFor(1000, 10, [](std::size_t begin, std::size_t)
+    {
+        if (begin == 500)
+        {
+            throw std::runtime_error("Jobs");
+        }
+    });
+    EXPECT_THROW(jobSystem.Wait(handle), std::runtime_error);
+    EXPECT_TRUE(handle.IsDone());
+}
+
+TEST(Jobs, ScheduleWith)
+{
+    auto manager = CreateEntityManager();
+    manager->SetWorkerThreadCount(4);
+    for (auto i = 0; i < 5000; i++)
+    {
+        manager->CreateEntityWith<TransformComponent>().GetComponent<TransformComponent>()->mData.x = 1.0f;
+    }
+    auto handle = manager->ScheduleWith<TransformComponent>([](Entity, TransformComponent* transform)
+                                                             {
+                                                                 transform->mData.y = transform->mData.x + 1.0f;
+                                                             });
+    manager->GetJobSystem().Wait(handle);
+    manager->With<TransformComponent>([](Entity, TransformComponent* transform)
+                                      {
+                                          EXPECT_EQ(2.0f, transform->GetY());
+                                      });
+}
+
+TEST(Jobs, Dependencies)
+{
+    JobSystem jobSystem(4);
+    std::atomic<int> step{ 0 };
+    auto first = jobSystem.Schedule([&] { step = 1; });
+    auto second = jobSystem.Schedule([&] { step = 2; });
+    auto last = jobSystem.Schedule([&]
+                                   {
+                                       EXPECT_TRUE(first.IsDone() && second.IsDone());
+                                       step = 3;
+                                   }, { first, second, JobHandle() });
+    jobSystem.Wait(last);
+    EXPECT_TRUE(first.IsDone());
+    EXPECT_TRUE(second.IsDone());
+    EXPECT_EQ(3, step);
+}
+
+TEST(Jobs, DestroyRunsQueuedJobs)
+{
+    std::atomic<int> step{ 0 };
+    JobHandle first;
+    JobHandle last;
+    {
+        // a single thread system only runs jobs while something waits
+        JobSystem jobSystem(1);
+        first = jobSystem.Schedule([&] { step += 1; });
+        last = jobSystem.Schedule([&] { step += 1; }, { first });
+        EXPECT_EQ(0, step);
+    }
+    EXPECT_TRUE(first.IsDone());
+    EXPECT_TRUE(last.IsDone());
+    EXPECT_EQ(2, step);
+}
+
+TEST(Jobs, SetWorkerThreadCountWithPendingJobs)
+{
+    auto manager = CreateEntityManager();
+    manager->SetWorkerThreadCount(1);
+    for (auto i = 0; i < 5000; i++)
+    {
+        manager->CreateEntityWith<TransformComponent>().GetComponent<TransformComponent>()->mData.x = 1.0f;
+    }
+    auto handle = manager->ScheduleWith<TransformComponent>([](Entity, TransformComponent* transform)
+                                                             {
+                                                                 transform->mData.y = transform->mData.x + 1.0f;
+                                                             });
+    manager->SetWorkerThreadCount(4);
+    EXPECT_TRUE(handle.IsDone());
+    manager->With<TransformComponent>([](Entity, TransformComponent* transform)
+                                      {
+                                          EXPECT_EQ(2.0f, transform->GetY());
+                                      });
+    manager->ParallelWith<TransformComponent>([](Entity, TransformComponent* transform)
+                                              {
+                                                  transform->mData.y += 1.0f;
+                                              });
+    EXPECT_EQ(3.0f, manager->With<TransformComponent>().front().GetComponent<TransformComponent>()->GetY());
+}
\ No newline at end of file
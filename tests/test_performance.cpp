@@ -12,7 +12,7 @@ TEST(Performance, CreateMaxEntities)
     auto manager = CreateEntityManager();
     const clock_t t0 = clock();
 
-    for (auto i = 0; i < std::numeric_limits<Entity::PointerSize>::max(); i++)
+    for (auto i = 0; i < std::numeric_limits<std::uint16_t>::max(); i++)
     {
         manager->CreateEntity();
     }
@@ -26,7 +26,7 @@ TEST(Performance, CreateMaxEntitiesWithComponents)
     auto manager = CreateEntityManager();
     const clock_t t0 = clock();
 
-    for (auto i = 0; i < std::numeric_limits<Entity::PointerSize>::max(); i++)
+    for (auto i = 0; i < std::numeric_limits<std::uint16_t>::max(); i++)
     {
         manager->CreateEntityWith<DummyComponent, TransformComponent, PhysicsComponent>();
     }
@@ -40,7 +40,7 @@ TEST(Performance, CreateMaxEntitiesWithComponentsAndUpdateThem)
     auto manager = CreateEntityManager();
     const clock_t t0 = clock();
 
-    for (auto i = 0; i < std::numeric_limits<Entity::PointerSize>::max(); i++)
+    for (auto i = 0; i < std::numeric_limits<std::uint16_t>::max(); i++)
     {
         if (i % 1000 == 0)
         {
@@ -0,0 +1,133 @@
+#include <sstream>
+#include <gtest/gtest.h>
+
+#include <core/entitymanager.hpp>
+
+#include "test_components/components.hpp"
+
+static std::unique_ptr<EntityManager> CreateSparseSetEntityManager()
+{
+    auto manager = std::make_unique<EntityManager>();
+    manager->RegisterComponent<DummyComponent>(ComponentStorage::eSparseSet);
+    manager->RegisterComponent<PhysicsComponent>(ComponentStorage::eArchetype);
+    manager->RegisterComponent<TransformComponent>(ComponentStorage::eSparseSet);
+    return manager;
+}
+
+TEST(SparseSets, AddGetRemoveComponent)
+{
+    auto manager = CreateSparseSetEntityManager();
+    std::vector<Entity> entities;
+    for (auto i = 0; i < 500; i++)
+    {
+        auto entity = manager->CreateEntityWith<TransformComponent>();
+        entity.GetComponent<TransformComponent>()->mData.x = static_cast<float>(i);
+        entities.emplace_back(entity);
+    }
+    for (auto i = 0; i < 500; i += 2)
+    {
+        entities[i].RemoveComponent<TransformComponent>();
+        EXPECT_ANY_THROW(entities[i].RemoveComponent<TransformComponent>());
+    }
+    for (auto i = 0; i < 500; i++)
+    {
+        if (i % 2 == 0)
+        {
+            EXPECT_EQ(nullptr, entities[i].GetComponent<TransformComponent>());
+        }
+        else
+        {
+            ASSERT_NE(nullptr, entities[i].GetComponent<TransformComponent>());
+            EXPECT_EQ(static_cast<float>(i), entities[i].GetComponent<TransformComponent>()->GetX());
+        }
+    }
+    EXPECT_EQ(250, manager->With<TransformComponent>().size());
+}
+
+TEST(SparseSets, WithMixedStorages)
+{
+    auto manager = CreateSparseSetEntityManager();
+    auto entity1 = manager->CreateEntityWith<TransformComponent, DummyComponent>();
+    auto entity2 = manager->CreateEntityWith<TransformComponent, PhysicsComponent>();
+    auto entity3 = manager->CreateEntityWith<TransformComponent, PhysicsComponent, DummyComponent>();
+    manager->CreateEntityWith<TransformComponent>();
+    entity1.Destroy();
+
+    auto count = 0;
+    manager->With<DummyComponent, TransformComponent>([&](auto e, auto dummy, auto transform)
+                                                      {
+                                                          EXPECT_EQ(entity3, e);
+                                                          EXPECT_EQ(e.template GetComponent<DummyComponent>(), dummy);
+                                                          EXPECT_EQ(e.template GetComponent<TransformComponent>(), transform);
+                                                          count += 1;
+                                                      });
+    EXPECT_EQ(1, count);
+
+    count = 0;
+    manager->With<TransformComponent, PhysicsComponent>([&](auto e, auto transform, auto physics)
+                                                        {
+                                                            EXPECT_TRUE(e == entity2 || e == entity3);
+                                                            EXPECT_EQ(e.template GetComponent<TransformComponent>(), transform);
+                                                            EXPECT_EQ(e.template GetComponent<PhysicsComponent>(), physics);
+                                                            count += 1;
+                                                        });
+    EXPECT_EQ(2, count);
+    EXPECT_EQ(3, manager->With<TransformComponent>().size());
+    EXPECT_EQ(2, (manager->Any<DummyComponent, PhysicsComponent>().size()));
+}
+
+TEST(SparseSets, SaveAndLoad)
+{
+    auto manager = CreateSparseSetEntityManager();
+    auto entity1 = manager->CreateEntityWith<DummyComponent, TransformComponent>();
+    entity1.GetComponent<TransformComponent>()->mData.x = 12.0f;
+    auto entity2 = manager->CreateEntityWith<PhysicsComponent, TransformComponent>();
+    entity2.GetComponent<TransformComponent>()->mData.y = 24.0f;
+
+    std::stringstream stream;
+    manager->Serialize(stream);
+    manager->Deserialize(stream);
+
+    ASSERT_TRUE(entity1.IsValid());
+    ASSERT_TRUE(entity2.IsValid());
+    EXPECT_TRUE((entity1.HasComponent<DummyComponent, TransformComponent>()));
+    EXPECT_TRUE((entity2.HasComponent<PhysicsComponent, TransformComponent>()));
+    EXPECT_EQ(12.0f, entity1.GetComponent<TransformComponent>()->GetX());
+    EXPECT_EQ(24.0f, entity2.GetComponent<TransformComponent>()->GetY());
+}
+
+TEST(SparseSets, DestroyWith)
+{
+    auto manager = CreateSparseSetEntityManager();
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<DummyComponent, TransformComponent>(500, entities);
+    manager->CreateEntitiesWith<TransformComponent, PhysicsComponent>(500, entities);
+    manager->DestroyWith<DummyComponent>();
+    EXPECT_EQ(500, manager->Size());
+    EXPECT_EQ(500, manager->With<TransformComponent>().size());
+    EXPECT_EQ(0, manager->With<DummyComponent>().size());
+    manager->DestroyEntities(manager->With<TransformComponent>());
+    EXPECT_EQ(0, manager->Size());
+}
+
+TEST(SparseSets, ShrinkToFit)
+{
+    auto manager = CreateSparseSetEntityManager();
+    std::vector<Entity> entities;
+    manager->CreateEntitiesWith<TransformComponent, PhysicsComponent>(5000, entities);
+    for (auto i = 0; i < 10; i++)
+    {
+        entities[i].GetComponent<TransformComponent>()->mData.x = static_cast<float>(i);
+    }
+    manager->DestroyEntities(entities.begin() + 10, entities.end());
+    manager->ShrinkToFit();
+    EXPECT_EQ(10, manager->ComponentCapacity<TransformComponent>());
+    EXPECT_LT(manager->ComponentCapacity<PhysicsComponent>(), 5000);
+    for (auto i = 0; i < 10; i++)
+    {
+        EXPECT_EQ(static_cast<float>(i), entities[i].GetComponent<TransformComponent>()->GetX());
+        EXPECT_TRUE(entities[i].HasComponent<PhysicsComponent>());
+    }
+    manager->CreateEntitiesWith<TransformComponent>(10, entities);
+    EXPECT_EQ(20, manager->With<TransformComponent>().size());
+}
@@ -1,8 +1,153 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <gtest/gtest.h>
 
 #include <core/entitymanager.hpp>
 
 #include "test_systems/systems.hpp"
+#include "test_components/components.hpp"
+
+namespace
+{
+    std::atomic<int> gUpdateCounter{ 0 };
+    std::atomic<int> gRunningReaders{ 0 };
+    std::atomic<bool> gUndeclaredRunning{ false };
+}
+
+class PhysicsUpdateSystem final : public System, public Writes<PhysicsComponent>
+{
+public:
+    DECLARE_SYSTEM(PhysicsUpdateSystem);
+
+protected:
+    void OnUpdate(float) final
+    {
+        mUpdateIndex = gUpdateCounter++;
+    }
+
+public:
+    int mUpdateIndex = -1;
+};
+
+class MovementSystem final : public System, public Reads<PhysicsComponent>, public Writes<TransformComponent>
+{
+public:
+    DECLARE_SYSTEM(MovementSystem);
+
+protected:
+    void OnUpdate(float dt) final
+    {
+        mManager->With<TransformComponent>([dt](Entity, TransformComponent* transform)
+                                           {
+                                               transform->mData.x += dt;
+                                           });
+        mUpdateIndex = gUpdateCounter++;
+    }
+
+public:
+    int mUpdateIndex = -1;
+};
+
+class RenderSystem final : public System, public Reads<TransformComponent>
+{
+public:
+    DECLARE_SYSTEM(RenderSystem);
+
+protected:
+    void OnUpdate(float) final
+    {
+        mManager->With<const TransformComponent>([this](Entity, const TransformComponent* transform)
+                                                 {
+                                                     mRenderedX = transform->GetX();
+                                                 });
+        mUpdateIndex = gUpdateCounter++;
+    }
+
+public:
+    float mRenderedX = 0.0f;
+    int mUpdateIndex = -1;
+};
+
+class LateSystem final : public System
+{
+public:
+    DECLARE_SYSTEM(LateSystem);
+
+protected:
+    void OnResolveDependencies() final
+    {
+        UpdateAfter(mManager->GetSystem<RenderSystem>());
+        UpdateAfter(mManager->GetSystem<LateSystem>() == this ? mLateDependency : nullptr);
+    }
+    void OnUpdate(float) final
+    {
+        mUpdateIndex = gUpdateCounter++;
+    }
+
+public:
+    const System* mLateDependency = nullptr;
+    int mUpdateIndex = -1;
+};
+
+template<typename C>
+class ReaderSystem : public System, public Reads<C>
+{
+protected:
+    void OnUpdate(float) override
+    {
+        gRunningReaders++;
+        mOverlapped = mOverlapped || gUndeclaredRunning;
+        // each reader asks for its own query so they are created concurrently
+        mCount = mManager->Query<C>().Size();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        mOverlapped = mOverlapped || gUndeclaredRunning;
+        gRunningReaders--;
+    }
+
+public:
+    std::size_t mCount = 0;
+    bool mOverlapped = false;
+};
+
+class TransformReaderSystem final : public ReaderSystem<TransformComponent>
+{
+public:
+    DECLARE_SYSTEM(TransformReaderSystem);
+};
+
+class PhysicsReaderSystem final : public ReaderSystem<PhysicsComponent>
+{
+public:
+    DECLARE_SYSTEM(PhysicsReaderSystem);
+};
+
+class UndeclaredSystem final : public System
+{
+public:
+    DECLARE_SYSTEM(UndeclaredSystem);
+
+protected:
+    void OnUpdate(float) final
+    {
+        gUndeclaredRunning = true;
+        mOverlapped = mOverlapped || gRunningReaders != 0;
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        mOverlapped = mOverlapped || gRunningReaders != 0;
+        gUndeclaredRunning = false;
+    }
+
+public:
+    bool mOverlapped = false;
+};
+
+DEFINE_SYSTEM(PhysicsUpdateSystem);
+DEFINE_SYSTEM(MovementSystem);
+DEFINE_SYSTEM(RenderSystem);
+DEFINE_SYSTEM(LateSystem);
+DEFINE_SYSTEM(TransformReaderSystem);
+DEFINE_SYSTEM(PhysicsReaderSystem);
+DEFINE_SYSTEM(UndeclaredSystem);
 
 TEST(System, AddSystem)
 {
@@ -38,4 +183,76 @@ TEST(System, Lifecycle)
     EXPECT_EQ(nullptr, gridMapSystem->mWorldStateSystem);
     manager.ResolveSystemDependencies();
     EXPECT_EQ(worldStateSystem, gridMapSystem->mWorldStateSystem);
-}
\ No newline at end of file
+}
+
+TEST(System, Update)
+{
+    auto manager = CreateEntityManager();
+    manager->SetWorkerThreadCount(4);
+    manager->CreateEntityWith<TransformComponent, PhysicsComponent>();
+    auto late = manager->AddSystem<LateSystem>();
+    auto render = manager->AddSystem<RenderSystem>();
+    auto physics = manager->AddSystem<PhysicsUpdateSystem>();
+    auto movement = manager->AddSystem<MovementSystem>();
+    manager->ResolveSystemDependencies();
+    EXPECT_EQ(Component::Mask<TransformComponent>(), movement->GetWriteComponents());
+    EXPECT_EQ(Component::Mask<PhysicsComponent>(), movement->GetReadComponents());
+
+    for (auto frame = 1; frame <= 10; frame++)
+    {
+        manager->Update(1.0f);
+        // render was added before movement so it sees the previous frame, late waits for render
+        EXPECT_LT(physics->mUpdateIndex, movement->mUpdateIndex);
+        EXPECT_LT(render->mUpdateIndex, movement->mUpdateIndex);
+        EXPECT_LT(render->mUpdateIndex, late->mUpdateIndex);
+        EXPECT_EQ(static_cast<float>(frame - 1), render->mRenderedX);
+    }
+
+    // a system updating after itself cannot be ordered
+    late->mLateDependency = late;
+    manager->ResolveSystemDependencies();
+    EXPECT_ANY_THROW(manager->Update(1.0f));
+}
+
+TEST(System, UndeclaredAccessRunsAlone)
+{
+    auto manager = CreateEntityManager();
+    manager->SetWorkerThreadCount(4);
+    manager->CreateEntityWith<TransformComponent, PhysicsComponent>();
+    manager->CreateEntityWith<TransformComponent>();
+    auto transforms = manager->AddSystem<TransformReaderSystem>();
+    auto undeclared = manager->AddSystem<UndeclaredSystem>();
+    auto physics = manager->AddSystem<PhysicsReaderSystem>();
+    manager->ResolveSystemDependencies();
+    EXPECT_EQ(~ComponentMask{}, undeclared->GetWriteComponents());
+    EXPECT_EQ(ComponentMask{}, physics->GetWriteComponents());
+
+    for (auto frame = 0; frame < 10; frame++)
+    {
+        manager->Update(1.0f);
+    }
+    EXPECT_FALSE(undeclared->mOverlapped);
+    EXPECT_FALSE(transforms->mOverlapped);
+    EXPECT_FALSE(physics->mOverlapped);
+    EXPECT_EQ(2, transforms->mCount);
+    EXPECT_EQ(1, physics->mCount);
+}
+
+TEST(System, TypeIdLookup)
+{
+    EXPECT_EQ(System::TypeId<WorldStateSystem>(), System::TypeId<WorldStateSystem>());
+    EXPECT_NE(System::TypeId<WorldStateSystem>(), System::TypeId<GridMapSystem>());
+
+    EntityManager manager;
+    EXPECT_EQ(nullptr, manager.GetSystem<RenderSystem>());
+    auto world = manager.AddSystem<WorldStateSystem>(nullptr, nullptr);
+    // adding other systems keeps earlier pointers valid
+    manager.AddSystem<GridMapSystem>();
+    manager.AddSystem<RenderSystem>();
+    EXPECT_EQ(world, manager.GetSystem<WorldStateSystem>());
+    manager.RemoveSystem<GridMapSystem>();
+    EXPECT_FALSE(manager.HasSystem<GridMapSystem>());
+    EXPECT_EQ(world, manager.GetSystem<WorldStateSystem>());
+    EXPECT_NE(nullptr, manager.GetSystem<RenderSystem>());
+    EXPECT_NE(nullptr, manager.AddSystem<GridMapSystem>());
+}